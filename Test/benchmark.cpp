@@ -0,0 +1,276 @@
+// 回环组播基准测试：同一进程内运行一个发送端和N个接收端，
+// 扫描消息大小、发送速率、接收端数量与窗口大小，每组参数输出一行CSV
+//
+// 用法：benchmark [--sizes 64,1024] [--rates 0,50000] [--receivers 1,4] [--windows 4096]
+//                 [--messages 20000] [--threads 0] [--timeout 30] [--group 239.255.0.42] [--port 31000]
+//                 [--coalesce 0] [--hold 1]
+// rate 为每秒消息数，0表示不限速；threads > 0 时所有会话共享该数量的事件循环线程
+// coalesce > 0 时发送端将小消息合并为不超过该字节数的报文，未满的报文最多等待 hold 毫秒
+//
+// g++ -std=c++11 -O2 -pthread -I../include benchmark.cpp ../src/*.cpp -o benchmark
+#include "sender.h"
+#include "MulticastReceiver.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/resource.h>
+
+struct BenchConfig
+{
+    std::vector<int> sizes;
+    std::vector<int> rates;
+    std::vector<int> receivers;
+    std::vector<int> windows;
+    int messages;
+    int threads;
+    int timeoutSec;
+    int coalesceBytes;
+    int holdMs;
+    std::string group;
+    int port;
+};
+
+struct BenchResult
+{
+    uint64_t delivered;   // 所有接收端收到的消息总数
+    double seconds;       // 首条消息发出到最后一条交付
+    double cpuSeconds;    // 进程用户态加内核态CPU时间
+    std::vector<uint32_t> latencies; // 微秒
+    uint64_t repairs;
+    uint64_t nacks;
+};
+
+static uint64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static double cpuTime()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+static std::vector<int> parseList(const char *text)
+{
+    std::vector<int> values;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ','))
+    {
+        values.push_back(std::atoi(item.c_str()));
+    }
+    return values;
+}
+
+static uint32_t percentile(const std::vector<uint32_t> &sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+    return sorted[index];
+}
+
+// 每条消息的前8字节为发送时刻，接收端据此计算交付延迟
+static BenchResult runOnce(const BenchConfig &config, int size, int rate, int receiverCount, int window, int port)
+{
+    std::unique_ptr<SessionManager> manager;
+    if (config.threads > 0)
+    {
+        manager.reset(new SessionManager(config.threads));
+        manager->start();
+    }
+
+    std::vector<std::unique_ptr<MulticastReceiver>> receivers;
+    for (int i = 0; i < receiverCount; ++i)
+    {
+        if (manager)
+            receivers.emplace_back(new MulticastReceiver(config.group, port, i + 1, *manager, window));
+        else
+            receivers.emplace_back(new MulticastReceiver(config.group, port, i + 1, window));
+        receivers.back()->start();
+    }
+    std::unique_ptr<MulticastSender> sender(manager ? new MulticastSender(config.group, port, *manager, window)
+                                                    : new MulticastSender(config.group, port, window));
+    sender->setCoalescing(config.coalesceBytes, config.holdMs);
+    sender->start();
+
+    BenchResult result;
+    result.delivered = 0;
+    std::vector<std::vector<uint32_t>> latencies(receiverCount);
+    std::vector<uint64_t> lastDelivery(receiverCount, 0);
+    std::atomic<int> finished(0);
+    std::atomic<bool> consuming(true);
+
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < receiverCount; ++i)
+    {
+        latencies[i].reserve(config.messages);
+        consumers.emplace_back([&, i]()
+                               {
+            ReceivedMessage batch[64];
+            int got = 0;
+            while (consuming && got < config.messages)
+            {
+                if (!receivers[i]->waitData(100))
+                    continue;
+                int n = receivers[i]->drain(batch, 64);
+                uint64_t now = nowNs();
+                for (int j = 0; j < n; ++j)
+                {
+                    uint64_t sentAt;
+                    memcpy(&sentAt, batch[j].content.data(), sizeof(sentAt));
+                    latencies[i].push_back(static_cast<uint32_t>((now - sentAt) / 1000));
+                }
+                got += n;
+                lastDelivery[i] = now;
+            }
+            finished++; });
+    }
+
+    std::string payload(std::max<int>(size, sizeof(uint64_t)), 'x');
+    double cpuStart = cpuTime();
+    uint64_t start = nowNs();
+    for (int i = 0; i < config.messages; ++i)
+    {
+        if (rate > 0)
+        {
+            // 按目标速率计算每条消息的发送时刻
+            uint64_t due = start + static_cast<uint64_t>(i) * 1000000000ULL / rate;
+            while (nowNs() < due)
+                std::this_thread::yield();
+        }
+        uint64_t sentAt = nowNs();
+        memcpy(&payload[0], &sentAt, sizeof(sentAt));
+        // 窗口已满时等待ACK释放空间
+        while (!sender->sendMessage(payload))
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+
+    uint64_t deadline = nowNs() + static_cast<uint64_t>(config.timeoutSec) * 1000000000ULL;
+    while (finished < receiverCount && nowNs() < deadline)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    consuming = false;
+    for (std::thread &t : consumers)
+    {
+        t.join();
+    }
+    result.cpuSeconds = cpuTime() - cpuStart;
+
+    uint64_t end = start;
+    for (int i = 0; i < receiverCount; ++i)
+    {
+        end = std::max(end, lastDelivery[i]);
+        result.delivered += latencies[i].size();
+        result.latencies.insert(result.latencies.end(), latencies[i].begin(), latencies[i].end());
+    }
+    result.seconds = (end - start) / 1e9;
+
+    SenderStats stats = sender->getStats();
+    result.repairs = stats.repairsSent;
+    result.nacks = stats.nacksReceived;
+
+    sender->stop();
+    for (auto &receiver : receivers)
+    {
+        receiver->stop();
+    }
+    sender.reset();
+    receivers.clear();
+    if (manager)
+    {
+        manager->stop();
+    }
+    return result;
+}
+
+int main(int argc, char **argv)
+{
+    BenchConfig config;
+    config.sizes = {64, 1024, 8192};
+    config.rates = {0};
+    config.receivers = {1, 4};
+    config.windows = {SEND_WINDOW_SIZE};
+    config.messages = 20000;
+    config.threads = 0;
+    config.timeoutSec = 30;
+    config.coalesceBytes = 0;
+    config.holdMs = 1;
+    config.group = "239.255.0.42";
+    config.port = 31000;
+
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        const char *value = argv[i + 1];
+        if (key == "--sizes")
+            config.sizes = parseList(value);
+        else if (key == "--rates")
+            config.rates = parseList(value);
+        else if (key == "--receivers")
+            config.receivers = parseList(value);
+        else if (key == "--windows")
+            config.windows = parseList(value);
+        else if (key == "--messages")
+            config.messages = std::atoi(value);
+        else if (key == "--threads")
+            config.threads = std::atoi(value);
+        else if (key == "--timeout")
+            config.timeoutSec = std::atoi(value);
+        else if (key == "--coalesce")
+            config.coalesceBytes = std::atoi(value);
+        else if (key == "--hold")
+            config.holdMs = std::atoi(value);
+        else if (key == "--group")
+            config.group = value;
+        else if (key == "--port")
+            config.port = std::atoi(value);
+        else
+        {
+            std::cerr << "unknown option " << key << std::endl;
+            return 1;
+        }
+    }
+
+    printf("size,rate,receivers,window,messages,delivered,seconds,msgs_per_sec,mb_per_sec,"
+           "p50_us,p99_us,p999_us,cpu_us_per_msg,repairs,nacks\n");
+    fflush(stdout);
+
+    // 每组参数使用不同端口，避免上一组残留的报文干扰
+    int port = config.port;
+    for (int size : config.sizes)
+        for (int rate : config.rates)
+            for (int receiverCount : config.receivers)
+                for (int window : config.windows)
+                {
+                    std::cerr << "running size=" << size << " rate=" << rate << " receivers=" << receiverCount
+                              << " window=" << window << std::endl;
+                    BenchResult r = runOnce(config, size, rate, receiverCount, window, port++);
+
+                    std::sort(r.latencies.begin(), r.latencies.end());
+                    double perReceiver = receiverCount > 0 ? static_cast<double>(r.delivered) / receiverCount : 0;
+                    double msgsPerSec = r.seconds > 0 ? perReceiver / r.seconds : 0;
+                    double cpuPerMsg = r.delivered > 0 ? r.cpuSeconds * 1e6 / r.delivered : 0;
+                    printf("%d,%d,%d,%d,%d,%llu,%.3f,%.0f,%.2f,%u,%u,%u,%.2f,%llu,%llu\n", size, rate, receiverCount,
+                           window, config.messages, static_cast<unsigned long long>(r.delivered), r.seconds, msgsPerSec,
+                           msgsPerSec * size / 1e6, percentile(r.latencies, 0.5), percentile(r.latencies, 0.99),
+                           percentile(r.latencies, 0.999), cpuPerMsg, static_cast<unsigned long long>(r.repairs),
+                           static_cast<unsigned long long>(r.nacks));
+                    fflush(stdout);
+                }
+    return 0;
+}
@@ -0,0 +1,232 @@
+// 以 std::map 为参照随机检查 BPlusTree：插入、删除、查找、lowerBound、顺序遍历与 extractRange
+// 每轮随机操作后比较两者的全部内容，小键值与大值两种实例分别覆盖多层内部节点与最小叶子容量
+//
+// 用法：bplusTreeTest [--ops 200000] [--keys 5000] [--seed 1]
+// 全部检查通过时输出 ok 并返回0，否则输出第一处不一致并返回非0
+//
+// g++ -std=c++11 -O2 -I../include bplusTreeTest.cpp -o bplusTreeTest
+#include "BPlusTree.h"
+#include <iostream>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+
+struct Wide
+{
+    int64_t id;
+    char payload[120];
+
+    Wide() : id(0) {}
+    explicit Wide(int64_t id) : id(id) {}
+};
+
+static int64_t valueId(int64_t value) { return value; }
+static int64_t valueId(const Wide &value) { return value.id; }
+
+template <typename V>
+class TreeCheck
+{
+public:
+    TreeCheck(const std::string &name, int keys, uint32_t seed) : name(name), keys(keys), random(seed) {}
+
+    bool run(int ops)
+    {
+        for (int i = 0; i < ops; ++i)
+        {
+            if (!step(i))
+            {
+                return false;
+            }
+            // 内容比较是全量的，只每隔若干步做一次
+            if (i % 997 == 0 && !compareAll(i))
+            {
+                return false;
+            }
+        }
+        if (!compareAll(ops))
+        {
+            return false;
+        }
+
+        // 全部删除后树应为空并释放全部节点
+        std::vector<int64_t> remaining;
+        for (const auto &entry : model)
+        {
+            remaining.push_back(entry.first);
+        }
+        for (int64_t key : remaining)
+        {
+            if (!tree.erase(key))
+            {
+                return fail(ops, "erase of remaining key " + std::to_string(key) + " failed");
+            }
+        }
+        model.clear();
+        if (!tree.empty() || tree.begin() != tree.end() || tree.nodeCount() != 0)
+        {
+            return fail(ops, "tree not empty after erasing every key");
+        }
+        std::cout << name << ": " << ops << " operations ok" << std::endl;
+        return true;
+    }
+
+private:
+    bool step(int i)
+    {
+        int64_t key = randomKey();
+        int op = static_cast<int>(random() % 100);
+        if (op < 45)
+        {
+            int64_t id = static_cast<int64_t>(random());
+            bool inserted = tree.insert(key, V(id));
+            bool expected = model.emplace(key, id).second;
+            if (inserted != expected)
+            {
+                return fail(i, "insert " + std::to_string(key) + " returned " + std::to_string(inserted));
+            }
+        }
+        else if (op < 75)
+        {
+            bool erased = tree.erase(key);
+            bool expected = model.erase(key) > 0;
+            if (erased != expected)
+            {
+                return fail(i, "erase " + std::to_string(key) + " returned " + std::to_string(erased));
+            }
+        }
+        else if (op < 88)
+        {
+            V *found = tree.find(key);
+            auto it = model.find(key);
+            if ((found != nullptr) != (it != model.end()) || (found != nullptr && valueId(*found) != it->second))
+            {
+                return fail(i, "find " + std::to_string(key) + " disagrees");
+            }
+        }
+        else if (op < 96)
+        {
+            // lowerBound 之后顺序走若干步
+            auto it = tree.lowerBound(key);
+            auto expected = model.lower_bound(key);
+            for (int n = 0; n < 20; ++n)
+            {
+                if ((it == tree.end()) != (expected == model.end()))
+                {
+                    return fail(i, "lowerBound " + std::to_string(key) + " ends at a different position");
+                }
+                if (expected == model.end())
+                {
+                    break;
+                }
+                if (it.key() != expected->first || valueId(it.value()) != expected->second)
+                {
+                    return fail(i, "lowerBound " + std::to_string(key) + " walks to a different element");
+                }
+                ++it;
+                ++expected;
+            }
+        }
+        else
+        {
+            int64_t high = key + static_cast<int64_t>(random() % (keys / 4 + 1));
+            std::vector<std::pair<int64_t, int64_t>> extracted;
+            size_t removed = tree.extractRange(key, high, [&extracted](const int64_t &k, V &v)
+                                               { extracted.emplace_back(k, valueId(v)); });
+            auto first = model.lower_bound(key);
+            auto last = model.lower_bound(high);
+            std::vector<std::pair<int64_t, int64_t>> expected(first, last);
+            model.erase(first, last);
+            if (removed != expected.size() || extracted != expected)
+            {
+                return fail(i, "extractRange [" + std::to_string(key) + ", " + std::to_string(high) + ") removed " +
+                                   std::to_string(removed) + ", expected " + std::to_string(expected.size()));
+            }
+        }
+        return true;
+    }
+
+    bool compareAll(int i)
+    {
+        if (tree.size() != model.size())
+        {
+            return fail(i, "size " + std::to_string(tree.size()) + ", expected " + std::to_string(model.size()));
+        }
+        auto expected = model.begin();
+        for (auto it = tree.begin(); it != tree.end(); ++it, ++expected)
+        {
+            if (expected == model.end() || it.key() != expected->first || valueId(it.value()) != expected->second)
+            {
+                return fail(i, "iteration differs at key " + std::to_string(it.key()));
+            }
+        }
+        if (expected != model.end())
+        {
+            return fail(i, "iteration stops before key " + std::to_string(expected->first));
+        }
+        return true;
+    }
+
+    int64_t randomKey()
+    {
+        // 偶尔取负数与大键，覆盖比较与边界
+        int64_t key = static_cast<int64_t>(random() % keys);
+        return (random() % 16 == 0) ? key - keys / 2 : key;
+    }
+
+    bool fail(int i, const std::string &what)
+    {
+        std::cout << name << ": FAIL at operation " << i << ": " << what << std::endl;
+        return false;
+    }
+
+    std::string name;
+    int keys;
+    std::mt19937 random;
+    BPlusTree<int64_t, V> tree;
+    std::map<int64_t, int64_t> model;
+};
+
+int main(int argc, char **argv)
+{
+    int ops = 200000;
+    int keys = 5000;
+    uint32_t seed = 1;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string key = argv[i];
+        if (key == "--ops")
+        {
+            ops = atoi(argv[i + 1]);
+        }
+        else if (key == "--keys")
+        {
+            keys = std::max(1, atoi(argv[i + 1]));
+        }
+        else if (key == "--seed")
+        {
+            seed = static_cast<uint32_t>(strtoul(argv[i + 1], nullptr, 10));
+        }
+        else
+        {
+            std::cerr << "unknown option " << key << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "leaf capacity " << BPlusTree<int64_t, int64_t>::LEAF_CAPACITY << " / "
+              << BPlusTree<int64_t, Wide>::LEAF_CAPACITY << ", inner capacity "
+              << BPlusTree<int64_t, int64_t>::INNER_CAPACITY << std::endl;
+
+    TreeCheck<int64_t> small("int64 values", keys, seed);
+    TreeCheck<Wide> wide("wide values", keys, seed + 1);
+    if (!small.run(ops) || !wide.run(ops))
+    {
+        return 1;
+    }
+    std::cout << "ok" << std::endl;
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <thread>
 #include <chrono>
+#include <atomic>
 
 void receiverCallback(const Event &event)
 {
@@ -19,13 +20,22 @@ int main()
 
     receiver.start();
 
-    std::thread receiveThread([&receiver]()
+    std::atomic<bool> consuming(true);
+    std::thread receiveThread([&receiver, &consuming]()
                               {
-        while (true)
+        ReceivedMessage batch[64];
+        while (consuming)
         {
-            Message msg = receiver.getData();
-            std::cout << "Received: " << msg.content << std::endl;
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            // 无数据时阻塞等待，不再轮询休眠
+            if (!receiver.waitData(100))
+            {
+                continue;
+            }
+            int n = receiver.drain(batch, 64);
+            for (int i = 0; i < n; ++i)
+            {
+                std::cout << "Received: " << batch[i].content << std::endl;
+            }
         } });
 
     // 等待一段时间以接收消息
@@ -33,6 +43,7 @@ int main()
 
     // 停止接收
     receiver.stop();
+    consuming = false;
     receiveThread.join();
 
     return 0;
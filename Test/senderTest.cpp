@@ -1,4 +1,4 @@
-#include "MulticastSender.h"
+#include "sender.h"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -0,0 +1,473 @@
+// 在进程内模拟网络上运行一个发送端和N个接收端，按给定的丢包、乱序、重复与时延参数
+// 检查每个接收端是否按序收到全部消息，并输出双方的恢复统计，用于复现与调整恢复行为
+//
+// 用法：simTest [--messages 5000] [--receivers 3] [--loss 0.01] [--burst 0 --burst-end 0.3]
+//               [--reorder 0 --reorder-delay 500] [--duplicate 0] [--delay 200] [--jitter 100]
+//               [--fec 0] [--log DIR] [--late 0 --join oldest] [--coalesce 0 --hold 1] [--initial-seq 0]
+//               [--size 0] [--link 0 --queue 65536 --slow-link 0] [--rate-policy none --rate 1048576 --floor 0 --max-rate 0]
+//               [--workers 0 --partitions 16 --work-us 0] [--seed 1] [--timeout 10]
+//               [--max-out-of-window -1] [--max-repair-ratio -1] [--min-fec-share -1]
+// --log 指定目录时启用发送日志，超出发送窗口的补包由日志提供
+// --late N 在发出N条消息后再加入一个接收端，按 --join 指定的位置（oldest 或 live）开始接收，
+// 检查其从起始消息到最后一条是否连续
+// --coalesce 启用小消息合并，此时还检查每条消息的消息序号与其内容一致
+// --size 将每条消息补齐到该字节数
+// --link 为每个接收端入口链路的带宽（字节/秒），--slow-link 单独设置接收端1的带宽，队列满时丢包
+// --rate-policy 取 slowest、p90 或 floor 时启用发送端速率控制，--rate 为起始速率，--floor 为 floor 策略的下限
+// --workers N 启用并行交付，消息按其编号对 --partitions 取模分区，在工作线程中检查每个分区内是否按序，
+// --work-us 为每条消息在工作线程中的模拟处理时间
+// --initial-seq 指定发送端首个序号，如 4294967000 可检查线上32位序号回绕前后的恢复与交付
+// --max-out-of-window 为各接收端超出重排窗口丢弃的报文总数上限，--max-repair-ratio 为补包数与发出的数据包数之比的上限，
+// --min-fec-share 为校验恢复占全部恢复（校验恢复 + NACK恢复）的比例下限；取负数时不检查，超出时即使全部收齐也判为失败
+// simTest --suite 依次运行文件末尾 SUITE 中的固定场景，任一场景失败时返回非0；
+// 场景中的 --log TMPDIR 在运行时换成新建的临时目录，场景结束后删除
+//
+// g++ -std=c++11 -O2 -pthread -I../include simTest.cpp ../src/*.cpp -o simTest
+#include "sender.h"
+#include "MulticastReceiver.h"
+#include "SimNetwork.h"
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <atomic>
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+// 并行交付时的顺序检查，每个分区只由一个工作线程访问
+struct PartitionCheck
+{
+    std::vector<int> last;
+    std::atomic<int> count;
+    std::atomic<int> lowest;
+    std::atomic<bool> ordered;
+
+    explicit PartitionCheck(int partitions) : last(partitions, -1), count(0), lowest(INT_MAX), ordered(true) {}
+};
+
+// 一次模拟的全部参数，命令行与 --suite 中的场景共用同一套选项
+struct SimOptions
+{
+    SimConfig config;
+    int messages;
+    int receiverCount;
+    int fec;
+    int timeoutSec;
+    std::string logDirectory;
+    int lateAfter;
+    JoinPolicy joinPolicy;
+    int coalesceBytes;
+    int holdMs;
+    int64_t initialSeq;
+    double slowLink;
+    size_t messageSize;
+    std::string ratePolicy;
+    int workers;
+    int partitions;
+    int workUs;
+    RateConfig rateConfig;
+    // 恢复开销的上下限，负数表示不检查
+    long long maxOutOfWindow;
+    double maxRepairRatio;
+    double minFecShare;
+
+    SimOptions()
+        : messages(5000), receiverCount(3), fec(0), timeoutSec(10), lateAfter(0), joinPolicy(JOIN_OLDEST),
+          coalesceBytes(0), holdMs(1), initialSeq(0), slowLink(0), messageSize(0), ratePolicy("none"), workers(0),
+          partitions(16), workUs(0), maxOutOfWindow(-1), maxRepairRatio(-1), minFecShare(-1)
+    {
+        config.lossRate = 0.01;
+        config.reorderDelayUs = 500;
+        config.burstEnd = 0.3;
+        config.delayUs = 200;
+        config.jitterUs = 100;
+        rateConfig.policy = RATE_TRACK_SLOWEST;
+        rateConfig.initialRate = 1 << 20;
+        rateConfig.floorRate = 0;
+        rateConfig.maxRate = 0;
+    }
+};
+
+// 解析一个选项，未知选项返回false
+static bool parseOption(SimOptions &o, const std::string &key, const char *value)
+{
+    if (key == "--messages")
+        o.messages = std::atoi(value);
+    else if (key == "--receivers")
+        o.receiverCount = std::atoi(value);
+    else if (key == "--loss")
+        o.config.lossRate = std::atof(value);
+    else if (key == "--burst")
+        o.config.burstStart = std::atof(value);
+    else if (key == "--burst-end")
+        o.config.burstEnd = std::atof(value);
+    else if (key == "--reorder")
+        o.config.reorderRate = std::atof(value);
+    else if (key == "--reorder-delay")
+        o.config.reorderDelayUs = std::atoi(value);
+    else if (key == "--duplicate")
+        o.config.duplicateRate = std::atof(value);
+    else if (key == "--delay")
+        o.config.delayUs = std::atoi(value);
+    else if (key == "--jitter")
+        o.config.jitterUs = std::atoi(value);
+    else if (key == "--fec")
+        o.fec = std::atoi(value);
+    else if (key == "--log")
+        o.logDirectory = value;
+    else if (key == "--late")
+        o.lateAfter = std::atoi(value);
+    else if (key == "--join")
+        o.joinPolicy = std::string(value) == "live" ? JOIN_LIVE : JOIN_OLDEST;
+    else if (key == "--coalesce")
+        o.coalesceBytes = std::atoi(value);
+    else if (key == "--hold")
+        o.holdMs = std::atoi(value);
+    else if (key == "--size")
+        o.messageSize = static_cast<size_t>(std::atoi(value));
+    else if (key == "--link")
+        o.config.linkBytesPerSec = std::atof(value);
+    else if (key == "--queue")
+        o.config.queueBytes = std::atoi(value);
+    else if (key == "--slow-link")
+        o.slowLink = std::atof(value);
+    else if (key == "--rate-policy")
+    {
+        o.ratePolicy = value;
+        o.rateConfig.policy = o.ratePolicy == "p90" ? RATE_TRACK_P90 : o.ratePolicy == "floor" ? RATE_FIXED_FLOOR
+                                                                                              : RATE_TRACK_SLOWEST;
+    }
+    else if (key == "--rate")
+        o.rateConfig.initialRate = std::atof(value);
+    else if (key == "--floor")
+        o.rateConfig.floorRate = std::atof(value);
+    else if (key == "--max-rate")
+        o.rateConfig.maxRate = std::atof(value);
+    else if (key == "--workers")
+        o.workers = std::atoi(value);
+    else if (key == "--partitions")
+        o.partitions = std::max(1, std::atoi(value));
+    else if (key == "--work-us")
+        o.workUs = std::atoi(value);
+    else if (key == "--initial-seq")
+        o.initialSeq = std::atoll(value);
+    else if (key == "--seed")
+        o.config.seed = static_cast<unsigned>(std::atoi(value));
+    else if (key == "--timeout")
+        o.timeoutSec = std::atoi(value);
+    else if (key == "--max-out-of-window")
+        o.maxOutOfWindow = std::atoll(value);
+    else if (key == "--max-repair-ratio")
+        o.maxRepairRatio = std::atof(value);
+    else if (key == "--min-fec-share")
+        o.minFecShare = std::atof(value);
+    else
+        return false;
+    return true;
+}
+
+// 运行一次模拟，所有接收端都按要求收齐且恢复开销不超过给定上限时返回true
+static bool runScenario(const SimOptions &o)
+{
+    SimNetwork network(o.config);
+    std::vector<std::unique_ptr<MulticastReceiver>> receivers;
+    std::vector<std::unique_ptr<PartitionCheck>> checks;
+    auto addReceiver = [&](int id, JoinPolicy policy)
+    {
+        Transport *transport = network.createTransport("239.255.0.1", 30000, true);
+        if (id == 1 && o.slowLink > 0)
+            network.setLinkRate(transport, o.slowLink);
+        receivers.emplace_back(new MulticastReceiver(std::unique_ptr<Transport>(transport), id));
+        receivers.back()->setJoinPolicy(policy);
+        if (o.workers > 0)
+        {
+            checks.emplace_back(new PartitionCheck(o.partitions));
+            PartitionCheck *check = checks.back().get();
+            receivers.back()->setDeliveryHandler(
+                o.workers, [&o](const ReceivedMessage &msg)
+                { return static_cast<uint64_t>(std::atoi(msg.content.c_str()) % o.partitions); },
+                [=, &o](ReceivedMessage &msg)
+                {
+                    int value = std::atoi(msg.content.c_str());
+                    int &last = check->last[value % o.partitions];
+                    if ((last >= 0 && value != last + o.partitions) ||
+                        (o.coalesceBytes > 0 && msg.sequenceNumber != o.initialSeq + value))
+                        check->ordered = false;
+                    last = value;
+                    int lowest = check->lowest;
+                    while (value < lowest && !check->lowest.compare_exchange_weak(lowest, value))
+                    {
+                    }
+                    if (o.workUs > 0)
+                    {
+                        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(o.workUs);
+                        while (std::chrono::steady_clock::now() < until)
+                        {
+                        }
+                    }
+                    check->count++;
+                });
+        }
+        receivers.back()->setCallback([id](const Event &event)
+                                      { std::cerr << "receiver " << id << ": " << event.message << std::endl; });
+        receivers.back()->start();
+    };
+    for (int i = 0; i < o.receiverCount; ++i)
+    {
+        addReceiver(i + 1, JOIN_OLDEST);
+    }
+    MulticastSender sender(std::unique_ptr<Transport>(network.createTransport("239.255.0.1", 30000, false)));
+    sender.setFec(o.fec);
+    sender.setCoalescing(o.coalesceBytes, o.holdMs);
+    sender.setInitialSequence(o.initialSeq);
+    if (o.ratePolicy != "none")
+    {
+        sender.setRateControl(o.rateConfig);
+    }
+    if (!o.logDirectory.empty() && !sender.setSendLog(o.logDirectory))
+    {
+        return false;
+    }
+    sender.start();
+    auto started = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < o.messages; ++i)
+    {
+        if (o.lateAfter > 0 && i == o.lateAfter)
+        {
+            addReceiver(o.receiverCount + 1, o.joinPolicy);
+        }
+        std::string message = std::to_string(i);
+        if (message.size() < o.messageSize)
+            message.resize(o.messageSize, ' ');
+        // 窗口已满时等待ACK释放空间
+        while (!sender.sendMessage(message))
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+
+    // 轮流读取各接收端，直到全部收齐或超时；按时加入的接收端须从第一条开始
+    bool passed = true;
+    int total = static_cast<int>(receivers.size());
+    std::vector<int> first(total, -1);
+    std::vector<int> next(total, 0);
+    std::vector<bool> ordered(total, true);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(o.timeoutSec);
+    int done = 0;
+    while (done < total && std::chrono::steady_clock::now() < deadline)
+    {
+        done = 0;
+        for (int i = 0; i < total; ++i)
+        {
+            if (o.workers > 0)
+            {
+                // 各分区分别按序，合起来从起始消息到当前连续时才算收齐
+                int count = checks[i]->count;
+                if (count > 0)
+                {
+                    first[i] = checks[i]->lowest;
+                    next[i] = first[i] + count;
+                }
+                ordered[i] = checks[i]->ordered;
+                if (next[i] == o.messages)
+                    done++;
+                continue;
+            }
+            ReceivedMessage msg;
+            while (receivers[i]->getData(msg))
+            {
+                int value = std::atoi(msg.content.c_str());
+                if (first[i] < 0)
+                    first[i] = next[i] = value;
+                if (value != next[i] || (o.coalesceBytes > 0 && msg.sequenceNumber != o.initialSeq + value))
+                    ordered[i] = false;
+                next[i]++;
+            }
+            if (next[i] == o.messages)
+                done++;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started);
+
+    uint64_t outOfWindow = 0, fecRecovered = 0, nackRecovered = 0;
+    for (int i = 0; i < total; ++i)
+    {
+        ReceiverStats stats = receivers[i]->getStats();
+        outOfWindow += stats.outOfWindow;
+        fecRecovered += stats.fecRecovered;
+        nackRecovered += stats.nackRecovered;
+        printf("receiver %d: delivered %d..%d of %d%s, nacks %llu, suppressed %llu, exhausted %llu, "
+               "fec recovered %llu, nack recovered %llu, out of window %llu, duplicates %llu\n",
+               i + 1, first[i], next[i] - 1, o.messages, ordered[i] ? "" : " OUT OF ORDER",
+               (unsigned long long)stats.nacksSent, (unsigned long long)stats.nacksSuppressed,
+               (unsigned long long)stats.nackRetriesExhausted, (unsigned long long)stats.fecRecovered,
+               (unsigned long long)stats.nackRecovered, (unsigned long long)stats.outOfWindow,
+               (unsigned long long)stats.duplicates);
+        passed = passed && ordered[i] && next[i] == o.messages && (i >= o.receiverCount || first[i] == 0);
+    }
+
+    SenderStats senderStats = sender.getStats();
+    printf("sender: messages %llu (%llu coalesced), packets %llu, repairs %llu (%llu from log), parity %llu, nacks %llu, rejected ranges %llu, "
+           "evicted %llu\n",
+           (unsigned long long)senderStats.messagesEnqueued, (unsigned long long)senderStats.messagesCoalesced,
+           (unsigned long long)senderStats.packetsSent, (unsigned long long)senderStats.repairsSent,
+           (unsigned long long)senderStats.logRepairsSent, (unsigned long long)senderStats.parityPacketsSent,
+           (unsigned long long)senderStats.nacksReceived, (unsigned long long)senderStats.nackRangesRejected,
+           (unsigned long long)senderStats.receiversEvicted);
+    if (o.ratePolicy != "none")
+    {
+        RateControlStats rate = sender.getRateStats();
+        printf("rate: %s, current %.0f B/s, limited by receiver %d (estimate %.0f B/s, loss %.4f, rtt %.0f us), "
+               "decreases %llu\n",
+               o.ratePolicy.c_str(), rate.rate, rate.limitingReceiver, rate.limitingRate, rate.limitingLoss,
+               rate.limitingRttUs, (unsigned long long)rate.decreases);
+    }
+    if (o.workers > 0)
+    {
+        uint64_t handled = 0;
+        for (auto &receiver : receivers)
+            handled += receiver->getStats().messagesHandled;
+        printf("delivery: %d workers, %d partitions, %llu messages handled in %lld ms\n", o.workers, o.partitions,
+               (unsigned long long)handled, (long long)elapsedMs.count());
+    }
+    SimStats netStats = network.stats();
+    printf("network: sent %llu, delivered %llu, dropped %llu (%llu queue full), duplicated %llu, reordered %llu\n",
+           (unsigned long long)netStats.sent, (unsigned long long)netStats.delivered,
+           (unsigned long long)netStats.dropped, (unsigned long long)netStats.queueDropped,
+           (unsigned long long)netStats.duplicated, (unsigned long long)netStats.reordered);
+
+    // 只检查最终交付会掩盖窗口配置不当引起的大量补包，按上限检查恢复开销
+    if (o.maxOutOfWindow >= 0 && outOfWindow > static_cast<uint64_t>(o.maxOutOfWindow))
+    {
+        printf("limit: out of window %llu exceeds %lld\n", (unsigned long long)outOfWindow, o.maxOutOfWindow);
+        passed = false;
+    }
+    double repairRatio = senderStats.packetsSent > 0
+                             ? static_cast<double>(senderStats.repairsSent) / senderStats.packetsSent
+                             : 0;
+    if (o.maxRepairRatio >= 0 && repairRatio > o.maxRepairRatio)
+    {
+        printf("limit: repair ratio %.3f exceeds %.3f\n", repairRatio, o.maxRepairRatio);
+        passed = false;
+    }
+    uint64_t recovered = fecRecovered + nackRecovered;
+    double fecShare = recovered > 0 ? static_cast<double>(fecRecovered) / recovered : 1;
+    if (o.minFecShare >= 0 && fecShare < o.minFecShare)
+    {
+        printf("limit: fec share %.3f of %llu recovered is below %.3f\n", fecShare, (unsigned long long)recovered,
+               o.minFecShare);
+        passed = false;
+    }
+
+    // 端点须在网络之前销毁
+    sender.stop();
+    for (auto &receiver : receivers)
+    {
+        receiver->stop();
+    }
+    receivers.clear();
+    printf(passed ? "PASS\n" : "FAIL\n");
+    return passed;
+}
+
+// --suite 运行的场景，每个场景的参数与命令行相同，全部通过时返回0
+struct Scenario
+{
+    const char *name;
+    const char *args;
+};
+
+static const Scenario SUITE[] = {
+    {"loss", "--max-out-of-window 0 --max-repair-ratio 0.1"},
+    {"reorder", "--loss 0.005 --reorder 0.05 --duplicate 0.02 --max-out-of-window 0 --max-repair-ratio 0.1"},
+    {"burst", "--loss 0.002 --burst 0.001 --max-out-of-window 0 --max-repair-ratio 0.1"},
+    // 迟到的接收方须经NACK补回加入前窗口中的消息
+    {"late-join", "--late 2000 --join oldest --max-out-of-window 0 --max-repair-ratio 0.3"},
+    // 合并后只有约20个报文，单个补包即占5%
+    {"coalesce", "--coalesce 1400 --hold 1 --max-out-of-window 0 --max-repair-ratio 0.5"},
+    {"rate", "--messages 10000 --rate-policy slowest --max-out-of-window 0 --max-repair-ratio 0.1"},
+    {"workers", "--workers 3 --partitions 7 --max-out-of-window 0 --max-repair-ratio 0.1"},
+    // 单个丢包应由校验恢复，NACK只补分组内的多个丢包
+    {"fec", "--fec 8 --max-out-of-window 0 --max-repair-ratio 0.1 --min-fec-share 0.8"},
+    {"wrap", "--initial-seq 4294967000 --max-out-of-window 0 --max-repair-ratio 0.1"},
+    {"wrap-fec", "--initial-seq 4294967000 --fec 8 --max-out-of-window 0 --max-repair-ratio 0.1 --min-fec-share 0.8"},
+    // 迟到的接收方从日志头部开始，须经NACK补回加入前的大部分消息，且起初领先其重排窗口的报文会被丢弃
+    {"log", "--messages 10000 --log TMPDIR --late 6000 --join oldest --max-out-of-window 10000 --max-repair-ratio 1.5"},
+};
+
+static int runSuite()
+{
+    int failed = 0;
+    for (const Scenario &scenario : SUITE)
+    {
+        SimOptions o;
+        std::stringstream ss(scenario.args);
+        std::vector<std::string> args;
+        std::string token;
+        while (ss >> token)
+        {
+            args.push_back(token);
+        }
+        printf("== %s %s\n", scenario.name, scenario.args);
+        fflush(stdout);
+        // 场景参数写错时不能退回默认参数运行
+        bool valid = args.size() % 2 == 0;
+        for (size_t i = 0; valid && i < args.size(); i += 2)
+        {
+            valid = parseOption(o, args[i], args[i + 1].c_str());
+        }
+        if (!valid)
+        {
+            printf("invalid options\nFAIL\n");
+            failed++;
+            continue;
+        }
+        // 每次运行使用独立的日志目录，并发运行的多个套件互不干扰
+        bool temporaryLog = o.logDirectory == "TMPDIR";
+        if (temporaryLog)
+        {
+            char directory[] = "/tmp/simTest-log-XXXXXX";
+            if (mkdtemp(directory) == nullptr)
+            {
+                perror("mkdtemp failed");
+                printf("FAIL\n");
+                failed++;
+                continue;
+            }
+            o.logDirectory = directory;
+        }
+        if (!runScenario(o))
+            failed++;
+        // 发送端析构时已删除全部段文件
+        if (temporaryLog)
+            rmdir(o.logDirectory.c_str());
+    }
+    printf("%d of %d scenarios failed\n", failed, static_cast<int>(sizeof(SUITE) / sizeof(SUITE[0])));
+    return failed == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && std::string(argv[1]) == "--suite")
+    {
+        return runSuite();
+    }
+
+    SimOptions o;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (!parseOption(o, argv[i], argv[i + 1]))
+        {
+            std::cerr << "unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    return runScenario(o) ? 0 : 1;
+}
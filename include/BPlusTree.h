@@ -1,40 +1,479 @@
 #ifndef BPLUSTREE_H
 #define BPLUSTREE_H
 
-#include <iostream>
-#include <vector>
-#include <cstring>
-#include "MulticastReceiver.h"
+#include <functional>
+#include <algorithm>
+#include <cstddef>
+#include "NodePool.h"
 
-template <typename T>
-class BPlusTreeNode
+// 有序映射：键唯一，按 Compare 递增排列
+// 节点为固定容量的数组，大小为 NODE_BYTES（4个缓存行），由节点池分配；叶子按键序单向链接，
+// 区间遍历只顺序访问叶子。K 与 V 需可默认构造与复制赋值，较大的值建议存放指针或下标
+// 非线程安全
+template <typename K, typename V, typename Compare = std::less<K>>
+class BPlusTree
 {
-public:
-    std::vector<T> keys;
-    std::vector<BPlusTreeNode *> children;
-    bool isLeaf;
+    static const int NODE_BYTES = 256;
+    static const int LEAF_FIT = static_cast<int>((NODE_BYTES - 16) / (sizeof(K) + sizeof(V)));
+    static const int INNER_FIT = static_cast<int>((NODE_BYTES - 16) / (sizeof(K) + sizeof(void *)));
 
-    BPlusTreeNode(bool leaf);
-};
+public:
+    static const int LEAF_CAPACITY = LEAF_FIT > 4 ? LEAF_FIT : 4;
+    static const int INNER_CAPACITY = INNER_FIT > 4 ? INNER_FIT : 4;
 
-template <typename T>
-class BPlusTree
-{
 private:
-    int degree;
-    BPlusTreeNode<T> *root;
+    struct alignas(64) Leaf
+    {
+        int count;
+        Leaf *next;
+        K keys[LEAF_CAPACITY];
+        V values[LEAF_CAPACITY];
+
+        Leaf() : count(0), next(nullptr) {}
+    };
 
-    void splitChild(BPlusTreeNode<T> *parent, int childIndex);
-    void insertIntoLeaf(BPlusTreeNode<T> *leaf, const T &key);
-    void insertIntoNonLeaf(BPlusTreeNode<T> *node, int index, const T &key);
-    void insertNonFull(BPlusTreeNode<T> *node, const T &key);
+    // children[i] 中的键位于 [keys[i - 1], keys[i]) 内
+    struct alignas(64) Inner
+    {
+        int count; // 键数，子节点数为 count + 1
+        K keys[INNER_CAPACITY];
+        void *children[INNER_CAPACITY + 1];
+
+        Inner() : count(0) {}
+    };
 
 public:
-    BPlusTree(int d);
-    void insert(const T &key);
-    T getMin();
-    void deleteMin();
-    bool isEmpty() const;
+    // 指向叶子中的一个位置，增删之后失效
+    class Iterator
+    {
+    public:
+        Iterator() : leaf(nullptr), index(0) {}
+
+        const K &key() const { return leaf->keys[index]; }
+        V &value() const { return leaf->values[index]; }
+
+        Iterator &operator++()
+        {
+            if (++index == leaf->count)
+            {
+                leaf = leaf->next;
+                index = 0;
+            }
+            return *this;
+        }
+
+        bool operator==(const Iterator &other) const { return leaf == other.leaf && index == other.index; }
+        bool operator!=(const Iterator &other) const { return !(*this == other); }
+
+    private:
+        friend class BPlusTree;
+        Iterator(Leaf *leaf, int index) : leaf(leaf), index(index) {}
+
+        Leaf *leaf;
+        int index;
+    };
+
+    explicit BPlusTree(const Compare &compare = Compare())
+        : less(compare), root(nullptr), height(0), count(0), head(nullptr)
+    {
+    }
+
+    ~BPlusTree()
+    {
+        clear();
+    }
+
+    BPlusTree(const BPlusTree &) = delete;
+    BPlusTree &operator=(const BPlusTree &) = delete;
+
+    bool empty() const { return count == 0; }
+    size_t size() const { return count; }
+
+    void clear()
+    {
+        if (root != nullptr)
+        {
+            destroy(root, height);
+        }
+        root = nullptr;
+        head = nullptr;
+        height = 0;
+        count = 0;
+    }
+
+    // 键已存在时不修改并返回false
+    bool insert(const K &key, const V &value)
+    {
+        if (root == nullptr)
+        {
+            head = leaves.allocate();
+            root = head;
+            height = 0;
+        }
+
+        Path path[MAX_HEIGHT];
+        Leaf *leaf = descend(key, path);
+        int i = lowerIndex(leaf, key);
+        if (i < leaf->count && !less(key, leaf->keys[i]))
+        {
+            return false;
+        }
+        count++;
+
+        if (leaf->count < LEAF_CAPACITY)
+        {
+            insertIntoLeaf(leaf, i, key, value);
+            return true;
+        }
+
+        // 叶子已满，后一半移入新叶子后再插入
+        Leaf *right = leaves.allocate();
+        int mid = LEAF_CAPACITY / 2;
+        right->count = leaf->count - mid;
+        std::copy(leaf->keys + mid, leaf->keys + leaf->count, right->keys);
+        std::copy(leaf->values + mid, leaf->values + leaf->count, right->values);
+        leaf->count = mid;
+        right->next = leaf->next;
+        leaf->next = right;
+        if (i <= mid)
+            insertIntoLeaf(leaf, i, key, value);
+        else
+            insertIntoLeaf(right, i - mid, key, value);
+
+        insertIntoParent(path, height - 1, right->keys[0], right);
+        return true;
+    }
+
+    // 不存在时返回nullptr
+    V *find(const K &key)
+    {
+        if (root == nullptr)
+        {
+            return nullptr;
+        }
+        Path path[MAX_HEIGHT];
+        Leaf *leaf = descend(key, path);
+        int i = lowerIndex(leaf, key);
+        return i < leaf->count && !less(key, leaf->keys[i]) ? &leaf->values[i] : nullptr;
+    }
+
+    bool erase(const K &key)
+    {
+        if (root == nullptr)
+        {
+            return false;
+        }
+        Path path[MAX_HEIGHT];
+        Leaf *leaf = descend(key, path);
+        int i = lowerIndex(leaf, key);
+        if (i == leaf->count || less(key, leaf->keys[i]))
+        {
+            return false;
+        }
+        eraseRun(path, leaf, i, 1);
+        return true;
+    }
+
+    Iterator begin() const { return Iterator(count > 0 ? head : nullptr, 0); }
+    Iterator end() const { return Iterator(); }
+
+    // 第一个不小于 key 的位置
+    Iterator lowerBound(const K &key) const
+    {
+        if (root == nullptr)
+        {
+            return end();
+        }
+        Path path[MAX_HEIGHT];
+        Leaf *leaf = descend(key, path);
+        int i = lowerIndex(leaf, key);
+        if (i == leaf->count)
+        {
+            return Iterator(leaf->next, 0);
+        }
+        return Iterator(leaf, i);
+    }
+
+    // 按键序取出并删除 [low, high) 内的全部元素，对每个元素调用 fn(const K &, V &)，返回删除个数
+    // 每次删除一个叶子中的连续一段，再整体调整一次树结构
+    template <typename F>
+    size_t extractRange(const K &low, const K &high, F fn)
+    {
+        size_t removed = 0;
+        while (root != nullptr)
+        {
+            Path path[MAX_HEIGHT];
+            Leaf *leaf = descend(low, path);
+            int i = lowerIndex(leaf, low);
+            if (i == leaf->count)
+            {
+                // 不小于 low 的元素从下一个叶子开始，按其首个键重新定位以取得路径
+                if (leaf->next == nullptr || !less(leaf->next->keys[0], high))
+                {
+                    break;
+                }
+                K first = leaf->next->keys[0];
+                leaf = descend(first, path);
+                i = 0;
+            }
+
+            int j = i;
+            while (j < leaf->count && less(leaf->keys[j], high))
+            {
+                fn(static_cast<const K &>(leaf->keys[j]), leaf->values[j]);
+                ++j;
+            }
+            if (j == i)
+            {
+                break;
+            }
+            removed += j - i;
+            eraseRun(path, leaf, i, j - i);
+        }
+        return removed;
+    }
+
+    // 使用中的节点数，用于估计内存占用
+    size_t nodeCount() const { return leaves.size() + inners.size(); }
+
+private:
+    static const int MAX_HEIGHT = 32;
+    static const int LEAF_MIN = LEAF_CAPACITY / 2;
+    static const int INNER_MIN = INNER_CAPACITY / 2;
+
+    // 从根到叶子经过的内部节点及所走的子节点下标
+    struct Path
+    {
+        Inner *node;
+        int index;
+    };
+
+    int lowerIndex(const Leaf *leaf, const K &key) const
+    {
+        return static_cast<int>(std::lower_bound(leaf->keys, leaf->keys + leaf->count, key, less) - leaf->keys);
+    }
+
+    Leaf *descend(const K &key, Path *path) const
+    {
+        void *node = root;
+        for (int level = 0; level < height; ++level)
+        {
+            Inner *inner = static_cast<Inner *>(node);
+            int i = static_cast<int>(std::upper_bound(inner->keys, inner->keys + inner->count, key, less) - inner->keys);
+            path[level].node = inner;
+            path[level].index = i;
+            node = inner->children[i];
+        }
+        return static_cast<Leaf *>(node);
+    }
+
+    void insertIntoLeaf(Leaf *leaf, int i, const K &key, const V &value)
+    {
+        std::copy_backward(leaf->keys + i, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+        std::copy_backward(leaf->values + i, leaf->values + leaf->count, leaf->values + leaf->count + 1);
+        leaf->keys[i] = key;
+        leaf->values[i] = value;
+        leaf->count++;
+    }
+
+    // 子节点分裂后把新的右半部分及其最小键插入上一层，逐层向上分裂
+    void insertIntoParent(Path *path, int level, K key, void *child)
+    {
+        for (; level >= 0; --level)
+        {
+            Inner *node = path[level].node;
+            int i = path[level].index;
+            if (node->count < INNER_CAPACITY)
+            {
+                std::copy_backward(node->keys + i, node->keys + node->count, node->keys + node->count + 1);
+                std::copy_backward(node->children + i + 1, node->children + node->count + 1,
+                                   node->children + node->count + 2);
+                node->keys[i] = key;
+                node->children[i + 1] = child;
+                node->count++;
+                return;
+            }
+
+            // 合并为 INNER_CAPACITY + 1 个键后从中间分开，中间键上移
+            K keys[INNER_CAPACITY + 1];
+            void *children[INNER_CAPACITY + 2];
+            std::copy(node->keys, node->keys + i, keys);
+            keys[i] = key;
+            std::copy(node->keys + i, node->keys + node->count, keys + i + 1);
+            std::copy(node->children, node->children + i + 1, children);
+            children[i + 1] = child;
+            std::copy(node->children + i + 1, node->children + node->count + 1, children + i + 2);
+
+            int total = INNER_CAPACITY + 1;
+            int mid = total / 2;
+            Inner *right = inners.allocate();
+            node->count = mid;
+            std::copy(keys, keys + mid, node->keys);
+            std::copy(children, children + mid + 1, node->children);
+            right->count = total - mid - 1;
+            std::copy(keys + mid + 1, keys + total, right->keys);
+            std::copy(children + mid + 1, children + total + 1, right->children);
+
+            key = keys[mid];
+            child = right;
+        }
+
+        Inner *newRoot = inners.allocate();
+        newRoot->count = 1;
+        newRoot->keys[0] = key;
+        newRoot->children[0] = root;
+        newRoot->children[1] = child;
+        root = newRoot;
+        height++;
+    }
+
+    // 删除叶子中从 i 开始的 n 个元素，不足半满时与相邻叶子合并或重新分配
+    void eraseRun(Path *path, Leaf *leaf, int i, int n)
+    {
+        std::copy(leaf->keys + i + n, leaf->keys + leaf->count, leaf->keys + i);
+        std::copy(leaf->values + i + n, leaf->values + leaf->count, leaf->values + i);
+        leaf->count -= n;
+        count -= n;
+
+        if (height == 0)
+        {
+            if (leaf->count == 0)
+            {
+                leaves.release(leaf);
+                root = nullptr;
+                head = nullptr;
+            }
+            return;
+        }
+        if (leaf->count >= LEAF_MIN)
+        {
+            return;
+        }
+
+        Inner *parent = path[height - 1].node;
+        int index = path[height - 1].index;
+        int separator = index > 0 ? index - 1 : 0;
+        Leaf *left = static_cast<Leaf *>(parent->children[separator]);
+        Leaf *right = static_cast<Leaf *>(parent->children[separator + 1]);
+
+        int total = left->count + right->count;
+        if (total <= LEAF_CAPACITY)
+        {
+            std::copy(right->keys, right->keys + right->count, left->keys + left->count);
+            std::copy(right->values, right->values + right->count, left->values + left->count);
+            left->count = total;
+            left->next = right->next;
+            leaves.release(right);
+            eraseFromInner(path, height - 1, separator);
+            return;
+        }
+
+        // 两个叶子平分元素
+        int leftCount = total / 2;
+        if (left->count > leftCount)
+        {
+            int moved = left->count - leftCount;
+            std::copy_backward(right->keys, right->keys + right->count, right->keys + right->count + moved);
+            std::copy_backward(right->values, right->values + right->count, right->values + right->count + moved);
+            std::copy(left->keys + leftCount, left->keys + left->count, right->keys);
+            std::copy(left->values + leftCount, left->values + left->count, right->values);
+        }
+        else
+        {
+            int moved = leftCount - left->count;
+            std::copy(right->keys, right->keys + moved, left->keys + left->count);
+            std::copy(right->values, right->values + moved, left->values + left->count);
+            std::copy(right->keys + moved, right->keys + right->count, right->keys);
+            std::copy(right->values + moved, right->values + right->count, right->values);
+        }
+        left->count = leftCount;
+        right->count = total - leftCount;
+        parent->keys[separator] = right->keys[0];
+    }
+
+    // 删除内部节点的第 i 个键及其右侧子节点，不足半满时逐层向上调整
+    void eraseFromInner(Path *path, int level, int i)
+    {
+        Inner *node = path[level].node;
+        std::copy(node->keys + i + 1, node->keys + node->count, node->keys + i);
+        std::copy(node->children + i + 2, node->children + node->count + 1, node->children + i + 1);
+        node->count--;
+
+        if (level == 0)
+        {
+            if (node->count == 0)
+            {
+                // 根只剩一个子节点，树高减一
+                root = node->children[0];
+                inners.release(node);
+                height--;
+            }
+            return;
+        }
+        if (node->count >= INNER_MIN)
+        {
+            return;
+        }
+
+        Inner *parent = path[level - 1].node;
+        int index = path[level - 1].index;
+        int separator = index > 0 ? index - 1 : 0;
+        Inner *left = static_cast<Inner *>(parent->children[separator]);
+        Inner *right = static_cast<Inner *>(parent->children[separator + 1]);
+
+        // 左节点、父节点分隔键、右节点依次排列
+        int total = left->count + 1 + right->count;
+        K keys[2 * INNER_CAPACITY + 1];
+        void *children[2 * INNER_CAPACITY + 2];
+        std::copy(left->keys, left->keys + left->count, keys);
+        keys[left->count] = parent->keys[separator];
+        std::copy(right->keys, right->keys + right->count, keys + left->count + 1);
+        std::copy(left->children, left->children + left->count + 1, children);
+        std::copy(right->children, right->children + right->count + 1, children + left->count + 1);
+
+        if (total <= INNER_CAPACITY)
+        {
+            left->count = total;
+            std::copy(keys, keys + total, left->keys);
+            std::copy(children, children + total + 1, left->children);
+            inners.release(right);
+            eraseFromInner(path, level - 1, separator);
+            return;
+        }
+
+        // 经父节点轮转，两个节点平分键
+        int mid = total / 2;
+        left->count = mid;
+        std::copy(keys, keys + mid, left->keys);
+        std::copy(children, children + mid + 1, left->children);
+        parent->keys[separator] = keys[mid];
+        right->count = total - mid - 1;
+        std::copy(keys + mid + 1, keys + total, right->keys);
+        std::copy(children + mid + 1, children + total + 1, right->children);
+    }
+
+    void destroy(void *node, int level)
+    {
+        if (level == 0)
+        {
+            leaves.release(static_cast<Leaf *>(node));
+            return;
+        }
+        Inner *inner = static_cast<Inner *>(node);
+        for (int i = 0; i <= inner->count; ++i)
+        {
+            destroy(inner->children[i], level - 1);
+        }
+        inners.release(inner);
+    }
+
+    Compare less;
+    void *root;
+    int height; // 内部节点层数，0 表示根为叶子
+    size_t count;
+    Leaf *head; // 最左叶子
+    NodePool<Leaf> leaves;
+    NodePool<Inner> inners;
 };
 
 #endif // BPLUSTREE_H
@@ -11,7 +11,8 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
-#include <sys/select.h>
+#include <sys/eventfd.h>
+#include <poll.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <mutex>
@@ -19,93 +20,223 @@
 #include <algorithm>
 #include <chrono>
 #include <functional>
-#include <BPlusTree.h>
+#include <random>
+#include "Protocol.h"
+#include "Trace.h"
+#include "ReorderWindow.h"
+#include "SpscQueue.h"
+#include "Reactor.h"
+#include "SessionManager.h"
+#include "UdpTransport.h"
+#include "Stats.h"
+#include "OrderedExecutor.h"
 #include <atomic>
 
-enum MessageType
+// 重组后交付给应用的完整消息
+struct ReceivedMessage
 {
-    INIT,
-    ACK,
-    NACK,
-    ACK_REQUEST,
-    DATA,
-    REPAIR
+    int64_t sequenceNumber; // 首个分片的序号，发送端启用合并时为消息序号
+    std::string content;
 };
 
-struct Message
+// 加入会话时的起始位置
+enum JoinPolicy
 {
-    MessageType type;
-    int sequenceNumber;
-    char content[256];
-    int nodeId;
-
-    Message(MessageType type, int seq, int id, const std::string &msg)
-        : type(type), sequenceNumber(seq), nodeId(id)
-    {
-        strncpy(content, msg.c_str(), sizeof(content));
-    }
-
-    bool operator<(const Message &other) const
-    {
-        return sequenceNumber < other.sequenceNumber;
-    }
-
-    bool operator==(const Message &other) const
-    {
-        return sequenceNumber == other.sequenceNumber;
-    }
+    JOIN_OLDEST, // 从发送端仍保留的最早报文开始，历史部分经补包按发送速率分段拉取
+    JOIN_LIVE    // 从发送端当前的发送位置开始，不接收历史
 };
 
-// 定义回调事件类型枚举
-enum EventType
+// 丢包恢复统计
+struct RecoveryStats
 {
-    EVENT_DATA,
-    NACK_ERROR,
+    unsigned long long fecRecovered;  // 由FEC校验在本地重建的报文数
+    unsigned long long nackRecovered; // 由NACK补包补回的报文数
 };
 
-struct Event
+// 接收端运行统计快照，计数器为累计值，gauge为读取时刻的近似值
+struct ReceiverStats
 {
-    EventType type;      // 事件类型
-    std::string message; // 事件消息内容
+    uint64_t packetsReceived;   // 通过校验的报文数（含补包与校验报文）
+    uint64_t bytesReceived;
+    uint64_t duplicates;        // 已交付或已缓存的重复报文数
+    uint64_t outOfWindow;       // 超出重排窗口被丢弃的报文数
+    uint64_t messagesDelivered; // 交付给应用的完整消息数
+    uint64_t acksSent;
+    uint64_t nacksSent;
+    uint64_t nacksSuppressed;   // 因NCF覆盖而未发送的NACK数
+    uint64_t nackRetriesExhausted;
+    uint64_t fecRecovered;
+    uint64_t nackRecovered;
+
+    uint64_t reorderDepth;      // gauge：重排窗口中缓存的报文数
+    uint64_t deliveryBacklog;   // gauge：等待应用取走（或等待工作线程执行）的消息数，持续增长说明消费过慢
+    uint64_t messagesHandled;   // 启用并行交付时工作线程已执行完的消息数
+
+    HistogramSnapshot repairLatencyUs; // 发出（或被抑制）NACK到补包到达的时间（微秒）
+    HistogramSnapshot windowSize;      // 每批报文处理后的重排窗口占用
 };
 
-const double nackTimeout = 1.0; // 超时时间（秒）
+const double nackTimeout = 1.0; // 发出NACK后等待补包的超时时间（秒）
+const int NACK_BACKOFF_MIN = 10; // 发现空洞后首次发送NACK前的随机退避区间（毫秒）
+const int NACK_BACKOFF_MAX = 60;
+const int NACK_MAX_RETRIES = 5;  // 同一空洞重发NACK超过该次数时回调NACK_ERROR
+const int RECV_BATCH_SIZE = 32; // 单次recvmmsg最多读取的报文数
+const int REORDER_WINDOW_SIZE = 4096; // 默认重排窗口容量，不小于发送端窗口（SEND_WINDOW_SIZE）：
+                                      // 发送端最多领先最慢接收方一个发送窗口，重排窗口能容纳时任何丢包后的报文都不会因超出窗口被丢弃
+const int DELIVERY_QUEUE_SIZE = 16384; // 网络线程到应用的交付队列容量
+const int DELIVERY_RETRY_MS = 1;       // 交付队列满时重试转入暂存消息的间隔
+const int DELIVERY_WORKER_QUEUE_SIZE = 4096; // 并行交付时网络线程到每个工作线程的队列容量
+const int FEC_PARITY_SLOTS = 16; // 暂存的尚无法恢复的校验报文数
+const int JOIN_RETRY_MS = 200;   // 入组请求未获应答时，收到后续报文后重发的最小间隔
 
 class MulticastReceiver
 {
 public:
-    MulticastReceiver(const std::string &multicastAddress, int port, int receiverId);
+    // windowSize 为重排窗口容量，超出窗口的乱序报文将被丢弃，依靠NACK补回；应不小于发送端窗口容量
+    // 独占一个事件循环线程
+    MulticastReceiver(const std::string &multicastAddress, int port, int receiverId,
+                      int windowSize = REORDER_WINDOW_SIZE);
+    // 由会话管理器的共享事件循环驱动，不单独创建线程
+    MulticastReceiver(const std::string &multicastAddress, int port, int receiverId, SessionManager &manager,
+                      int windowSize = REORDER_WINDOW_SIZE);
+    // 使用指定的传输（如 SimNetwork 的端点），transport 须已加入组播组
+    MulticastReceiver(std::unique_ptr<Transport> transport, int receiverId, int windowSize = REORDER_WINDOW_SIZE);
+    MulticastReceiver(std::unique_ptr<Transport> transport, int receiverId, SessionManager &manager,
+                      int windowSize = REORDER_WINDOW_SIZE);
     ~MulticastReceiver();
 
     void start();
     void stop();
 
     void setCallback(std::function<void(const Event &)> cb);
-    Message getData();
+    // 设置入组起始位置，需在start前调用，默认 JOIN_OLDEST
+    void setJoinPolicy(JoinPolicy policy);
+    // 启用并行交付，需在start前调用：按序交付的消息不再进入 getData 队列，
+    // 而是按 partitionKey 分发到 workers 个工作线程上调用 handler；
+    // 分区键相同的消息按交付顺序依次执行，不同分区的消息并行执行
+    // partitionKey 在网络线程中调用，应尽量轻量；stop 返回前已交付的消息均已执行完
+    void setDeliveryHandler(int workers, std::function<uint64_t(const ReceivedMessage &)> partitionKey,
+                            std::function<void(ReceivedMessage &)> handler);
+    // 以下消费接口只允许单个应用线程调用，不加锁
+    // 取出一条按序重组好的消息，队列为空时返回false
+    bool getData(ReceivedMessage &msg);
+    // 批量取出最多max条消息，返回取出条数
+    int drain(ReceivedMessage *batch, int max);
+    // 阻塞等待直到有数据或超时，timeoutMs < 0 表示一直等待；有数据时返回true
+    bool waitData(int timeoutMs);
+    RecoveryStats getRecoveryStats() const;
+    // 可在任意线程调用，不加锁，不影响收发
+    ReceiverStats getStats() const;
 
 private:
+    MulticastReceiver(std::unique_ptr<Transport> transport, int receiverId, SessionManager *manager, int windowSize);
+
     void run();
-    void handleMessage(const Message &msg);
-    // void processBuffer();
-    void handleRepair(const Message &msg);
-    void sendACK();
-    void sendNACK(int startSeq, int endSeq);
-
-    int sockfd;
-    struct sockaddr_in addr;
-    std::string multicastAddress;
-    int port;
+    // 在事件循环中注册与注销套接字、定时器
+    void attach();
+    void detach();
+    // 读空套接字，在事件循环线程中执行
+    void onReadable();
+    // NACK定时器到期：发送或重发NACK
+    void onNackTimer();
+    void armNackTimer(uint64_t delayMs);
+    void stopRecovery();
+    // 重排窗口中有空洞，或发送端已发出的报文尚未收到
+    bool missingData() const;
+    // 交付进展后检查：无缺失时结束恢复，上次NACK范围已补齐时退避后再发NACK
+    void checkRecovery();
+    // 批量处理一次recvmmsg读到的报文，整批处理完后统一交付
+    void handleBatch(int count);
+    // 以下处理函数只在网络线程中调用
+    // 入组完成前缓存报文，按需发送INIT请求
+    void handleJoining(const Message &msg);
+    // 收到INIT应答，确定起始序号后重新处理缓存的报文
+    void handleJoin(const Message &msg);
+    // 报文被接收（未重复且在窗口内）时返回true，seq 为还原后的逻辑序号
+    bool handleMessage(const Message &msg, int64_t seq);
+    void handleRepair(const Message &msg, int64_t seq);
+    // 收到其他接收方触发的NCF，覆盖本地全部空洞时不再发送自己的NACK
+    void handleNCF(const Message &msg);
+    // 收到校验报文，能恢复时立即恢复，否则暂存
+    void handleParity(const Message &parity);
+    // 分组内恰好缺一个报文时重建并交付；分组已无需或无法恢复时返回true，可丢弃校验
+    bool recoverFromParity(const Message &parity);
+    // 用暂存的校验重试恢复，每批报文处理后及发送NACK前调用
+    void retryParities();
+    // 按序交付单个报文，分片报文在此重组
+    void deliver(const Message &msg, int64_t seq);
+    void enqueue(ReceivedMessage &&msg);
+    // 将暂存的溢出消息转入交付队列，并在消费者等待时唤醒
+    void flushDelivery();
+    // 应答ACK请求，带回请求的负载
+    void sendACK(const Message &request);
+    // 发送覆盖重排窗口中全部空洞及尾部缺失的NACK
+    void sendNACK();
+
+    std::unique_ptr<Transport> transport;
+    struct sockaddr_in addr; // 最近一个报文的源地址，ACK/NACK回复到此
+    // recvmmsg预分配的接收缓冲
+    std::vector<Message> recvBuffers;
+    struct mmsghdr recvHdrs[RECV_BATCH_SIZE];
+    struct iovec recvIovs[RECV_BATCH_SIZE];
+    struct sockaddr_in recvAddrs[RECV_BATCH_SIZE];
     int receiverId;
-    int lastReceived;
-    int lastAckExchange;
-    std::deque<Message> receiveQueue;
-    std::mutex queueMutex;
+    // 序号均为64位逻辑序号，收到的线上序号以 lastReceived + 1 为参照还原
+    int64_t lastReceived;
+    int64_t lastAckExchange;
+    int64_t senderHighest; // ACK_REQUEST 通告的发送端最大序号
+    int64_t nextMessageNumber; // 下一条消息的消息序号，作为还原合并报文消息序号的参照
+    // 入组状态：收到应答前不处理数据，已收到的报文暂存，超出重排窗口容量的部分之后经NACK补回
+    JoinPolicy joinPolicy;
+    bool joined;
+    uint64_t joinSentMs;
+    std::vector<Message> joinBacklog;
+    // 网络线程为唯一生产者，应用线程为唯一消费者
+    SpscQueue<ReceivedMessage> receiveQueue;
+    // 交付队列满时暂存，仅网络线程访问
+    std::deque<ReceivedMessage> overflowQueue;
+    // 并行交付，未启用时为空
+    std::function<uint64_t(const ReceivedMessage &)> partitionKey;
+    std::unique_ptr<OrderedExecutor<ReceivedMessage>> executor;
+    int notifyFd;
+    std::atomic<bool> consumerWaiting;
+    // 分片重组状态
+    std::string fragmentBuffer;
+    int64_t fragmentSeq;
+    int nextFragment;
     std::function<void(const Event &)> callback;
-    std::pair<int, int> nackRanges;
+    std::pair<int64_t, int64_t> nackRanges; // 上次NACK覆盖的范围，从首个空洞起点到最后一个空洞终点
     int inNackRecoveryCount;
     int isSendNACK;
-    BPlusTree<Message> skipCountTree;
-    std::chrono::time_point<std::chrono::steady_clock> receiveSkipMsg;
+    std::minstd_rand backoffRng;
+    ReorderWindow<Message> skipWindow;
+    // 收到过校验报文后，按序交付的报文也保留在重排窗口槽位中供恢复使用
+    bool fecActive;
+    std::vector<Message> fecParities;
+
+    // 运行统计，均由事件循环线程写入
+    StatCounter packetsReceived;
+    StatCounter bytesReceived;
+    StatCounter duplicates;
+    StatCounter outOfWindow;
+    StatCounter messagesDelivered;
+    StatCounter acksSent;
+    StatCounter nacksSent;
+    StatCounter nacksSuppressed;
+    StatCounter nackRetriesExhausted;
+    StatCounter fecRecovered;
+    StatCounter nackRecovered;
+    StatCounter reorderGauge;
+    StatCounter overflowGauge;
+    Histogram repairLatency;
+    Histogram windowSize;
+    uint64_t nackSentUs; // 最近一次发出或被抑制NACK的时间
+    // 事件循环，未使用会话管理器时独占一个Reactor
+    SessionManager *manager;
+    std::unique_ptr<Reactor> ownedReactor;
+    Reactor *reactor;
+    TimerWheel::TimerId nackTimer;
+    TimerWheel::TimerId flushTimer; // 暂存消息的重试定时器
     std::atomic<bool> running;
     std::thread receiverThread;
 };
@@ -0,0 +1,86 @@
+#ifndef NODEPOOL_H
+#define NODEPOOL_H
+
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+
+// 定长对象池：按块申请按缓存行对齐的内存，归还的对象进入空闲链表复用，稳态下不再分配内存
+// 非线程安全；池销毁时释放全部块，使用者须先归还所有对象
+template <typename T, size_t ChunkObjects = 64>
+class NodePool
+{
+public:
+    NodePool() : freeList(nullptr), live(0) {}
+
+    ~NodePool()
+    {
+        for (void *chunk : chunks)
+        {
+            free(chunk);
+        }
+    }
+
+    NodePool(const NodePool &) = delete;
+    NodePool &operator=(const NodePool &) = delete;
+
+    // 返回默认构造的对象
+    T *allocate()
+    {
+        if (freeList == nullptr)
+        {
+            grow();
+        }
+        FreeSlot *slot = freeList;
+        freeList = slot->next;
+        live++;
+        return new (slot) T();
+    }
+
+    void release(T *object)
+    {
+        object->~T();
+        FreeSlot *slot = reinterpret_cast<FreeSlot *>(object);
+        slot->next = freeList;
+        freeList = slot;
+        live--;
+    }
+
+    // 已分配未归还的对象数
+    size_t size() const { return live; }
+
+private:
+    struct FreeSlot
+    {
+        FreeSlot *next;
+    };
+
+    static const size_t CACHE_LINE = 64;
+    static const size_t SLOT_SIZE =
+        ((sizeof(T) > sizeof(FreeSlot) ? sizeof(T) : sizeof(FreeSlot)) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+
+    void grow()
+    {
+        void *chunk = nullptr;
+        if (posix_memalign(&chunk, CACHE_LINE, SLOT_SIZE * ChunkObjects) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        chunks.push_back(chunk);
+        // 逆序入链，使分配顺序与内存顺序一致
+        char *base = static_cast<char *>(chunk);
+        for (size_t i = ChunkObjects; i-- > 0;)
+        {
+            FreeSlot *slot = reinterpret_cast<FreeSlot *>(base + i * SLOT_SIZE);
+            slot->next = freeList;
+            freeList = slot;
+        }
+    }
+
+    std::vector<void *> chunks;
+    FreeSlot *freeList;
+    size_t live;
+};
+
+#endif // NODEPOOL_H
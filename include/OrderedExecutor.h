@@ -0,0 +1,228 @@
+#ifndef ORDEREDEXECUTOR_H
+#define ORDEREDEXECUTOR_H
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include "SpscQueue.h"
+#include "Stats.h"
+
+const int EXECUTOR_BATCH_SIZE = 32; // 工作线程单次从队列取出的任务数
+
+// 按分区键保序的并行执行器：同一分区键的任务总在同一个工作线程上按提交顺序执行，不同分区并行执行
+// 只允许单个提交线程；每个工作线程一个SPSC队列，队列满时任务暂存在提交方，由 flush 转入
+template <typename T>
+class OrderedExecutor
+{
+public:
+    OrderedExecutor(int threads, size_t queueCapacity, std::function<void(T &)> handler)
+        : handler(handler), running(false)
+    {
+        for (int i = 0; i < std::max(1, threads); ++i)
+        {
+            workers.emplace_back(new Worker(queueCapacity));
+        }
+    }
+
+    ~OrderedExecutor() { stop(); }
+
+    int threadCount() const { return static_cast<int>(workers.size()); }
+
+    void start()
+    {
+        if (running.exchange(true))
+        {
+            return;
+        }
+        for (auto &worker : workers)
+        {
+            Worker *w = worker.get();
+            w->thread = std::thread([this, w]()
+                                    { run(*w); });
+        }
+    }
+
+    // 执行完已提交的全部任务后返回，调用前提交线程须已停止提交
+    void stop()
+    {
+        if (!running)
+        {
+            return;
+        }
+        // 暂存的任务随工作线程消费逐步转入队列
+        while (backlog() > 0)
+        {
+            flush();
+            std::this_thread::yield();
+        }
+        running.store(false, std::memory_order_release);
+        for (auto &worker : workers)
+        {
+            wake(*worker);
+        }
+        for (auto &worker : workers)
+        {
+            if (worker->thread.joinable())
+            {
+                worker->thread.join();
+            }
+        }
+    }
+
+    // 以下三个接口仅提交线程调用
+    void submit(uint64_t key, T &&item)
+    {
+        Worker &w = *workers[partition(key)];
+        // 已有暂存任务时必须排在其后，保证分区内顺序
+        if (!w.overflow.empty() || !w.queue.push(std::move(item)))
+        {
+            w.overflow.push_back(std::move(item));
+        }
+    }
+
+    // 将暂存任务转入队列并唤醒等待中的工作线程，每提交一批任务后调用
+    void flush()
+    {
+        for (auto &worker : workers)
+        {
+            Worker &w = *worker;
+            while (!w.overflow.empty() && w.queue.push(std::move(w.overflow.front())))
+            {
+                w.overflow.pop_front();
+            }
+            // 与 run 中的 waiting 写入配对，避免丢失唤醒
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (w.waiting.load(std::memory_order_relaxed) && !w.queue.empty())
+            {
+                wake(w);
+            }
+        }
+    }
+
+    // 暂存在提交方、尚未进入队列的任务数
+    size_t backlog() const
+    {
+        size_t total = 0;
+        for (const auto &worker : workers)
+        {
+            total += worker->overflow.size();
+        }
+        return total;
+    }
+
+    // 任意线程可调用：已进入队列尚未执行的任务数（近似）
+    size_t pending() const
+    {
+        size_t total = 0;
+        for (const auto &worker : workers)
+        {
+            total += worker->queue.size();
+        }
+        return total;
+    }
+
+    // 任意线程可调用：已执行完的任务数
+    uint64_t completed() const
+    {
+        uint64_t total = 0;
+        for (const auto &worker : workers)
+        {
+            total += worker->executed.get();
+        }
+        return total;
+    }
+
+private:
+    struct Worker
+    {
+        SpscQueue<T> queue;
+        std::deque<T> overflow; // 仅提交线程访问
+        std::vector<T> batch;   // 仅工作线程访问
+        int notifyFd;
+        std::atomic<bool> waiting;
+        StatCounter executed;
+        std::thread thread;
+
+        explicit Worker(size_t capacity) : queue(capacity), batch(EXECUTOR_BATCH_SIZE), waiting(false)
+        {
+            notifyFd = eventfd(0, EFD_NONBLOCK);
+            if (notifyFd < 0)
+            {
+                perror("eventfd failed");
+                exit(EXIT_FAILURE);
+            }
+        }
+
+        ~Worker() { close(notifyFd); }
+    };
+
+    size_t partition(uint64_t key) const
+    {
+        // 乘法散列打散步长规律的分区键
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> 32) % workers.size();
+    }
+
+    static void wake(Worker &w)
+    {
+        uint64_t one = 1;
+        ssize_t n = write(w.notifyFd, &one, sizeof(one));
+        (void)n;
+    }
+
+    void run(Worker &w)
+    {
+        for (;;)
+        {
+            size_t n = w.queue.pop(w.batch.data(), w.batch.size());
+            if (n > 0)
+            {
+                for (size_t i = 0; i < n; ++i)
+                {
+                    handler(w.batch[i]);
+                }
+                w.executed.add(n);
+                continue;
+            }
+            if (!running.load(std::memory_order_acquire))
+            {
+                // 停止前提交的任务均已入队，取空后退出
+                if (w.queue.empty())
+                {
+                    break;
+                }
+                continue;
+            }
+
+            w.waiting.store(true, std::memory_order_seq_cst);
+            if (w.queue.empty() && running.load(std::memory_order_acquire))
+            {
+                struct pollfd pfd;
+                pfd.fd = w.notifyFd;
+                pfd.events = POLLIN;
+                if (poll(&pfd, 1, -1) > 0)
+                {
+                    uint64_t value;
+                    ssize_t r = read(w.notifyFd, &value, sizeof(value));
+                    (void)r;
+                }
+            }
+            w.waiting.store(false, std::memory_order_relaxed);
+        }
+    }
+
+    std::function<void(T &)> handler;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> running;
+};
+
+#endif // ORDEREDEXECUTOR_H
@@ -0,0 +1,228 @@
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+// 发送端与接收端共用的报文类型，两端取值必须一致
+enum MessageType
+{
+    INIT, // 接收方入组请求，发送端以组播的INIT应答，负载为 JoinInfo
+    DATA,
+    ACK,
+    NACK,
+    ACK_REQUEST, // sequenceNumber 为发送端已发出的最大序号，负载为发送时间戳，接收方在ACK中原样带回用于测量RTT
+    REPAIR,
+    FEC,
+    NCF // 发送方对NACK的组播确认，其他接收方据此抑制自己的NACK
+};
+
+// 序号：会话内使用64位逻辑序号，不会回绕；报文头只携带其低32位（线上序号），
+// 接收时按序号算术（RFC 1982）取与参照序号距离小于 2^31 的逻辑序号还原，
+// 参照取本端当前位置（发送端为发送位置，接收端为期望的下一个序号），双方窗口远小于 2^31
+inline uint32_t toWireSeq(int64_t seq)
+{
+    return static_cast<uint32_t>(seq);
+}
+
+inline int64_t fromWireSeq(uint32_t wire, int64_t reference)
+{
+    return reference + static_cast<int32_t>(wire - static_cast<uint32_t>(reference));
+}
+
+// 线上序号 a 是否在 b 之前
+inline bool wireSeqBefore(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b) < 0;
+}
+
+const int MAX_DATAGRAM_SIZE = 1472;  // 以太网MTU 1500 - IP头20 - UDP头8
+const int HEADER_SIZE = 16;          // 报文头长度
+const int MAX_PAYLOAD_SIZE = MAX_DATAGRAM_SIZE - HEADER_SIZE;
+const int MAX_MESSAGE_SIZE = 65536;  // 单条消息最大长度，超过单个报文时分片发送
+const int MAX_FRAGMENTS = (MAX_MESSAGE_SIZE + MAX_PAYLOAD_SIZE - 1) / MAX_PAYLOAD_SIZE;
+
+// FEC校验报文：sequenceNumber 为分组首个序号，fragCount 为分组内DATA报文数
+// 负载为 FecHeader 加上分组内各报文负载按最长补零后的异或
+struct FecHeader
+{
+    uint16_t lengthXor;
+    uint16_t fragIndexXor;
+    uint16_t fragCountXor;
+    uint16_t flagsXor;
+    int32_t nodeIdXor;
+};
+
+const int FEC_HEADER_SIZE = sizeof(FecHeader);
+// 启用FEC时DATA负载上限，保证校验报文不超过单个报文
+const int MAX_FEC_PAYLOAD_SIZE = MAX_PAYLOAD_SIZE - FEC_HEADER_SIZE;
+
+// dst ^= src，按8字节批量处理
+inline void xorBytes(char *dst, const char *src, size_t n)
+{
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+    {
+        uint64_t a, b;
+        memcpy(&a, dst + i, 8);
+        memcpy(&b, src + i, 8);
+        a ^= b;
+        memcpy(dst + i, &a, 8);
+    }
+    for (; i < n; ++i)
+    {
+        dst[i] ^= src[i];
+    }
+}
+
+// DATA报文的 flags，发送端启用合并时设置
+const uint8_t MESSAGE_NUMBERED = 0x01; // nodeId 为消息序号的低32位，交付时代替报文序号
+const uint8_t MESSAGE_BATCH = 0x02;    // 负载为多条合并的消息，每条为2字节长度加内容，消息序号从 nodeId 起递增
+
+// 报文在内存与线上格式一致：16字节头 + length字节负载，字段为主机字节序
+// 发送时只发送前 wireSize() 字节，小消息对应小报文
+struct Message
+{
+    uint8_t type;
+    uint8_t flags;
+    uint16_t length;        // 负载长度
+    uint32_t sequenceNumber; // 线上序号，即逻辑序号的低32位
+    int32_t nodeId;
+    uint16_t fragIndex;     // 分片下标，从0开始
+    uint16_t fragCount;     // 分片总数，未分片时为1
+    char content[MAX_PAYLOAD_SIZE];
+
+    Message(MessageType type, int64_t seq, int id, const char *data, size_t len)
+        : type(type), flags(0), sequenceNumber(toWireSeq(seq)), nodeId(id), fragIndex(0), fragCount(1)
+    {
+        setContent(data, len);
+    }
+
+    Message(MessageType type, int64_t seq, int id, const std::string &msg)
+        : Message(type, seq, id, msg.data(), msg.size())
+    {
+    }
+
+    // 超出单个报文的部分被截断，需要完整发送的数据应由发送端分片
+    void setContent(const char *data, size_t len)
+    {
+        length = static_cast<uint16_t>(len < sizeof(content) ? len : sizeof(content));
+        memcpy(content, data, length);
+    }
+
+    std::string text() const { return std::string(content, length); }
+
+    size_t wireSize() const { return HEADER_SIZE + length; }
+
+    // 校验收到的报文长度与头部声明的负载长度一致
+    bool isValid(size_t received) const
+    {
+        return received >= static_cast<size_t>(HEADER_SIZE) && received == wireSize() && fragIndex < fragCount;
+    }
+
+    bool operator<(const Message &other) const
+    {
+        return wireSeqBefore(sequenceNumber, other.sequenceNumber);
+    }
+
+    bool operator==(const Message &other) const
+    {
+        return sequenceNumber == other.sequenceNumber;
+    }
+};
+
+static_assert(offsetof(Message, content) == HEADER_SIZE, "Message header must match the wire format");
+
+// NACK与NCF负载：NackHeader 后接 rangeCount 个按序号递增、互不重叠的闭区间
+// base 为接收方期望的下一个序号，序号均为线上序号
+struct NackHeader
+{
+    uint32_t base;
+    uint16_t rangeCount;
+    uint16_t reserved;
+};
+
+struct NackRange
+{
+    uint32_t start;
+    uint32_t end;
+};
+
+const int NACK_HEADER_SIZE = sizeof(NackHeader);
+const int MAX_NACK_RANGES = (MAX_PAYLOAD_SIZE - NACK_HEADER_SIZE) / sizeof(NackRange);
+
+inline void initNack(Message &msg, MessageType type, int64_t base, int nodeId)
+{
+    NackHeader header = {toWireSeq(base), 0, 0};
+    msg.type = type;
+    msg.flags = 0;
+    msg.sequenceNumber = header.base;
+    msg.nodeId = nodeId;
+    msg.fragIndex = 0;
+    msg.fragCount = 1;
+    msg.length = NACK_HEADER_SIZE;
+    memcpy(msg.content, &header, NACK_HEADER_SIZE);
+}
+
+// 追加一个区间，负载已满时返回false
+inline bool appendNackRange(Message &msg, int64_t start, int64_t end)
+{
+    NackHeader header;
+    memcpy(&header, msg.content, NACK_HEADER_SIZE);
+    if (header.rangeCount >= MAX_NACK_RANGES)
+    {
+        return false;
+    }
+    NackRange range = {toWireSeq(start), toWireSeq(end)};
+    memcpy(msg.content + NACK_HEADER_SIZE + header.rangeCount * sizeof(NackRange), &range, sizeof(range));
+    header.rangeCount++;
+    memcpy(msg.content, &header, NACK_HEADER_SIZE);
+    msg.length = static_cast<uint16_t>(NACK_HEADER_SIZE + header.rangeCount * sizeof(NackRange));
+    return true;
+}
+
+// 校验负载长度并读出报头，之后用 nackRange 按下标读取区间
+inline bool parseNack(const Message &msg, NackHeader &header)
+{
+    if (msg.length < NACK_HEADER_SIZE)
+    {
+        return false;
+    }
+    memcpy(&header, msg.content, NACK_HEADER_SIZE);
+    return msg.length == NACK_HEADER_SIZE + header.rangeCount * sizeof(NackRange);
+}
+
+inline NackRange nackRange(const Message &msg, int index)
+{
+    NackRange range;
+    memcpy(&range, msg.content + NACK_HEADER_SIZE + index * sizeof(NackRange), sizeof(range));
+    return range;
+}
+
+// INIT应答负载：发送端当前可补发的最早序号与已发出的最大序号，均为完整的逻辑序号，
+// 作为接收方还原线上序号的初始参照；message 为发送端下一条消息的消息序号，用于还原合并报文的消息序号
+struct JoinInfo
+{
+    int64_t oldest;
+    int64_t highest;
+    int64_t message;
+};
+
+// 定义回调事件类型枚举，发送端与接收端共用，便于同一进程中同时使用两端
+enum EventType
+{
+    INQUEUE_ERROR,  // 发送端：消息无法入队
+    NACK_OUT_QUEUE, // 发送端：NACK范围已不在发送窗口中
+    EVENT_DATA,     // 接收端：数据事件
+    NACK_ERROR      // 接收端：NACK重试耗尽
+};
+
+struct Event
+{
+    EventType type;      // 事件类型
+    std::string message; // 事件消息内容
+};
+
+#endif // PROTOCOL_H
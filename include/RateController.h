@@ -0,0 +1,104 @@
+#ifndef RATECONTROLLER_H
+#define RATECONTROLLER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+// 速率跟随的目标
+enum RatePolicy
+{
+    RATE_TRACK_SLOWEST, // 跟随可承受速率最低的接收方，所有接收方都不应因拥塞丢包
+    RATE_TRACK_P90,     // 跟随90%的接收方可承受的速率，更慢的接收方依靠补包或被踢除
+    RATE_FIXED_FLOOR    // 跟随最慢的接收方，但不低于 floorRate，跟不上下限的接收方由踢除规则处理
+};
+
+struct RateConfig
+{
+    RatePolicy policy;
+    double initialRate; // 起始速率（字节/秒）
+    double floorRate;   // RATE_FIXED_FLOOR 的速率下限（字节/秒），其他策略的下限为 RATE_MIN
+    double maxRate;     // 速率上限（字节/秒），0表示不限
+};
+
+// 速率控制状态快照
+struct RateControlStats
+{
+    double rate;           // 当前发送速率（字节/秒），未启用时为0
+    int limitingReceiver;  // 决定当前速率的接收方，-1表示没有接收方在限速
+    double limitingRate;   // 该接收方可承受的速率估计（字节/秒）
+    double limitingLoss;   // 该接收方的丢包率估计
+    double limitingRttUs;  // 该接收方的RTT估计（微秒）
+    uint64_t decreases;    // 累计降速次数
+};
+
+const double RATE_MIN = 16 * 1024;     // 任何策略下的最低速率，保证仍能收到反馈
+const double RATE_INCREASE = 0.125;    // 无接收方受限时每次ACK交换速率最多增长的比例
+const double RATE_DECREASE = 0.5;      // 每次ACK交换速率最多降为原来的比例
+const double RATE_EWMA_WEIGHT = 0.25;  // 丢包率、ACK进展与RTT的平滑系数
+const uint64_t RATE_DEFAULT_RTT_US = 100000; // 尚无RTT样本时使用的估计值
+
+// 基于接收方反馈的速率控制，在每次ACK交换时更新一次：
+// 每个接收方按三项反馈估计可承受的速率：
+//   丢包率：由NACK报告的新丢失序号数除以本周期发出的报文数，按简化的TCP友好公式
+//           rate = packetBytes / (rtt * sqrt(2p/3)) 折算为速率
+//   RTT：ACK请求携带的发送时间戳由接收方在ACK中带回
+//   ACK进展：积压超过阈值且仍在增长时，接收方的消费速率即其可承受速率
+// 再按策略取目标速率：低于当前速率时降速（每次最多减半），否则按 RATE_INCREASE 逐步增长
+// 非线程安全，由发送端在 queueMutex 下调用
+class RateController
+{
+public:
+    RateController();
+
+    void configure(const RateConfig &config);
+    double rate() const { return currentRate; }
+
+    // 接收方确认到 ack，rttUs 为本次ACK交换测得的RTT，无样本时为0
+    void onAck(int nodeId, int64_t ack, uint64_t rttUs);
+    // 接收方NACK了闭区间 [start, end]，每个序号对同一接收方只计一次丢包
+    void onNack(int nodeId, int64_t start, int64_t end);
+    // 接收方被踢除或离开
+    void erase(int nodeId);
+    // 速率仍可能为该接收方下调（它决定了当前速率或尚未完成测量，且速率未降到下限），此时不应踢除它
+    bool slowingFor(int nodeId) const;
+
+    // 每次ACK交换时调用：sendPointer 为下一个待发序号，bytesSent 与 packetsSent 为累计的首次发送量（用于平均报文长度），
+    // backlogLimit 为接收方积压的告警阈值（报文数）；返回新的速率（字节/秒）
+    double update(uint64_t nowUs, int64_t sendPointer, uint64_t bytesSent, uint64_t packetsSent, int backlogLimit);
+
+    RateControlStats stats() const;
+
+private:
+    struct Feedback
+    {
+        int64_t ack;
+        int64_t lastAck;    // 上次更新时的ack
+        int64_t lastBacklog;
+        int64_t nackedUpTo; // 已计入丢包的最大序号
+        uint64_t lost;      // 本周期新报告的丢失序号数
+        double lossRate;
+        double ackRate;     // 报文/秒，0表示尚无样本
+        double rttUs;       // 0表示尚无样本
+        double allowed;     // 可承受的速率估计（字节/秒），0表示不受限
+        bool acked;         // 是否收到过ACK
+        bool sampled;       // 上次更新时是否已有ack
+        bool measured;      // 是否已按两次更新间的ACK进展估计过可承受速率
+    };
+
+    Feedback &feedback(int nodeId);
+    double floor() const;
+
+    RateConfig config;
+    double currentRate;
+    std::unordered_map<int, Feedback> receivers;
+    std::vector<std::pair<double, int>> limits; // 复用的排序缓冲：可承受速率与接收方
+    int64_t intervalStart;   // 本周期开始时的 sendPointer
+    uint64_t intervalUs;     // 本周期开始时间
+    uint64_t intervalBytes;  // 本周期开始时的累计发送字节数
+    int limitingReceiver;
+    uint64_t decreases;
+};
+
+#endif // RATECONTROLLER_H
@@ -0,0 +1,64 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <sys/epoll.h>
+#include "TimerWheel.h"
+
+// 基于epoll的事件循环，文件描述符事件与时间轮定时器在同一线程中驱动
+// 除 wakeup、post、invoke 外的接口只能在事件循环线程中调用（或在 run 之前调用）
+// 一个Reactor可以同时承载多个收发会话
+class Reactor
+{
+public:
+    typedef std::function<void(uint32_t)> Handler;
+
+    Reactor();
+    ~Reactor();
+
+    bool addFd(int fd, uint32_t events, Handler handler);
+    void removeFd(int fd);
+
+    TimerWheel::TimerId runAfter(uint64_t delayMs, std::function<void()> callback);
+    bool cancelTimer(TimerWheel::TimerId id);
+
+    // 线程安全，唤醒阻塞在 epoll_wait 中的事件循环
+    void wakeup();
+    // 线程安全，把任务投递到事件循环线程执行
+    void post(std::function<void()> task);
+    // 线程安全，在事件循环线程中同步执行任务并等待完成
+    // 事件循环未运行或当前就在事件循环线程时直接执行；不能在其他Reactor的回调中等待自身
+    void invoke(std::function<void()> task);
+
+    // 处理一轮就绪事件与到期定时器，无事件时最多等待到下一个定时器
+    void runOnce();
+    // 循环直到 running 为false，停止时需配合 wakeup 唤醒
+    void run(const std::atomic<bool> &running);
+
+    static uint64_t nowMs();
+    static uint64_t nowUs();
+
+private:
+    static const int MAX_EVENTS = 64;
+
+    void runTasks();
+
+    int epollFd;
+    int wakeFd;
+    TimerWheel timers;
+    std::unordered_map<int, Handler> handlers;
+
+    // 跨线程投递的任务
+    std::mutex taskMutex;
+    std::vector<std::function<void()>> tasks;
+    bool looping;
+    std::thread::id loopThread;
+};
+
+#endif // REACTOR_H
@@ -0,0 +1,67 @@
+#ifndef RECEIVERTABLE_H
+#define RECEIVERTABLE_H
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+struct ReceiverNode
+{
+    int64_t ackSequenceNumber;
+    int nodeId;
+    uint64_t activeMs; // 最近一次ack前进或发来NACK的时间，用于判断接收方是否仍在恢复
+
+    ReceiverNode(int64_t ack, int id, uint64_t nowMs);
+
+    bool operator==(const ReceiverNode &other) const;
+};
+
+// 接收方表：按 ackSequenceNumber 排列的最小堆，加上 nodeId 到堆下标的开放寻址哈希索引
+// 更新与删除为 O(log n)，取最慢接收方为 O(1)
+class ReceiverTable
+{
+public:
+    ReceiverTable();
+
+    bool empty() const { return heap.empty(); }
+    size_t size() const { return heap.size(); }
+
+    // 插入新接收方，或将已有接收方的ack提高到 ack，ack不会回退；插入或ack前进时记为活跃
+    void update(int nodeId, int64_t ack, uint64_t nowMs);
+    // 接收方发来NACK，说明仍在恢复，记为活跃；不在表中时忽略
+    void touch(int nodeId, uint64_t nowMs);
+    bool erase(int nodeId);
+    // ack最小的接收方，表为空时返回nullptr
+    const ReceiverNode *min() const { return heap.empty() ? nullptr : &heap[0]; }
+    // ack不小于 ack 的接收方中ack最小者，不存在时返回nullptr；只访问ack更小的节点及其子节点
+    const ReceiverNode *minAtLeast(int64_t ack) const;
+    // 未找到时返回nullptr
+    const ReceiverNode *find(int nodeId) const;
+
+private:
+    static const int EMPTY = -1;
+
+    struct Slot
+    {
+        int nodeId;
+        int heapIndex; // EMPTY 表示空槽
+    };
+
+    size_t bucketOf(int nodeId) const;
+    // 返回 nodeId 所在槽位或应插入的空槽位
+    size_t probe(int nodeId) const;
+    void grow();
+    // 线性探测删除：把后续同簇元素前移填补空位，不使用墓碑
+    void removeSlot(size_t slot);
+
+    void swapNodes(size_t a, size_t b);
+    void siftUp(size_t index);
+    void siftDown(size_t index);
+
+    std::vector<ReceiverNode> heap;
+    std::vector<Slot> slots; // 容量为2的幂，负载不超过一半
+    // 与 heap 平行，记录每个堆元素在 slots 中的位置，交换堆元素时据此更新索引
+    std::vector<size_t> slotOf;
+};
+
+#endif // RECEIVERTABLE_H
@@ -0,0 +1,152 @@
+#ifndef REORDERWINDOW_H
+#define REORDERWINDOW_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+// 接收端重排窗口：按 sequenceNumber & mask 定位的槽位数组加到达位图
+// 窗口覆盖 [base(), base() + capacity())，序号为64位逻辑序号，T 需提供 sequenceNumber 成员（线上序号）
+template <typename T>
+class ReorderWindow
+{
+public:
+    // 容量向上取整为2的幂且不小于64，保证位图按字对齐
+    ReorderWindow(int capacity, const T &init)
+        : slots(roundUp(std::max(capacity, 64)), init), next(0), highest(-1), count(0)
+    {
+        mask = static_cast<int>(slots.size()) - 1;
+        bitmap.assign(slots.size() / 64, 0);
+    }
+
+    bool empty() const { return count == 0; }
+    int size() const { return count; }
+    int capacity() const { return static_cast<int>(slots.size()); }
+
+    // 下一个期望交付的序号
+    int64_t base() const { return next; }
+    // 已缓存的最大序号
+    int64_t highestSeq() const { return highest; }
+
+    // 仅在窗口为空时调用，直接移动期望序号
+    void reset(int64_t seq)
+    {
+        next = seq;
+        highest = seq - 1;
+    }
+
+    bool contains(int64_t seq) const
+    {
+        return seq >= next && seq <= highest && testBit(seq);
+    }
+
+    // 直接访问序号对应的槽位，用于在快速交付路径上保留报文副本
+    T &slot(int64_t seq) { return slots[seq & mask]; }
+
+    // 查找仍在槽位中的报文：包括已缓存未交付的，以及已交付但槽位尚未被覆盖的
+    // 槽位中报文的 sequenceNumber 与 seq 的低32位一致才视为有效
+    const T *find(int64_t seq) const
+    {
+        const T &candidate = slots[seq & mask];
+        if (candidate.sequenceNumber != static_cast<uint32_t>(seq) || seq >= next + capacity() || (seq >= next && !testBit(seq)))
+        {
+            return nullptr;
+        }
+        return &candidate;
+    }
+
+    // 以逻辑序号 seq 缓存报文，重复或超出窗口时返回false
+    bool insert(int64_t seq, const T &msg)
+    {
+        if (seq < next || seq >= next + capacity() || testBit(seq))
+        {
+            return false;
+        }
+        slots[seq & mask] = msg;
+        bitmap[(seq & mask) >> 6] |= 1ULL << (seq & 63);
+        highest = std::max(highest, seq);
+        count++;
+        return true;
+    }
+
+    // 按序取出从 base() 开始连续到达的报文交给 fn(msg, seq)，返回取出个数
+    template <typename F>
+    int drain(F fn)
+    {
+        int64_t end = findBit(next, highest + 1, false);
+        for (int64_t seq = next; seq < end; ++seq)
+        {
+            fn(slots[seq & mask], seq);
+            bitmap[(seq & mask) >> 6] &= ~(1ULL << (seq & 63));
+        }
+        int drained = static_cast<int>(end - next);
+        count -= drained;
+        next = end;
+        return drained;
+    }
+
+    // 枚举 [base(), highestSeq()] 中所有缺口，fn(start, end) 为闭区间
+    template <typename F>
+    void forEachGap(F fn) const
+    {
+        int64_t seq = next;
+        while (seq <= highest)
+        {
+            int64_t gapStart = findBit(seq, highest + 1, false);
+            if (gapStart > highest)
+            {
+                break;
+            }
+            int64_t gapEnd = findBit(gapStart, highest + 1, true);
+            fn(gapStart, gapEnd - 1);
+            seq = gapEnd;
+        }
+    }
+
+private:
+    static int roundUp(int n)
+    {
+        int size = 1;
+        while (size < n)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    bool testBit(int64_t seq) const
+    {
+        return (bitmap[(seq & mask) >> 6] >> (seq & 63)) & 1;
+    }
+
+    // 在 [from, limit) 中查找第一个位值为 value 的序号，按字扫描，找不到返回 limit
+    int64_t findBit(int64_t from, int64_t limit, bool value) const
+    {
+        int64_t seq = from;
+        while (seq < limit)
+        {
+            int bit = static_cast<int>(seq & 63);
+            uint64_t word = bitmap[(seq & mask) >> 6];
+            if (!value)
+            {
+                word = ~word;
+            }
+            word >>= bit;
+            if (word != 0)
+            {
+                return std::min<int64_t>(seq + __builtin_ctzll(word), limit);
+            }
+            seq += 64 - bit;
+        }
+        return limit;
+    }
+
+    std::vector<T> slots;
+    std::vector<uint64_t> bitmap;
+    int64_t mask;
+    int64_t next;
+    int64_t highest;
+    int count;
+};
+
+#endif // REORDERWINDOW_H
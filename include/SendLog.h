@@ -0,0 +1,77 @@
+#ifndef SENDLOG_H
+#define SENDLOG_H
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "Protocol.h"
+
+const size_t SEND_LOG_SEGMENT_SIZE = 64 << 20; // 默认单个段文件大小
+const int SEND_LOG_MAX_SEGMENTS = 16;          // 默认最多保留的段数，超出时删除最老的段
+
+// 发送日志：位于内存发送窗口之后，保存已被窗口释放的报文，供落后的接收方补包
+// 按序号连续追加到内存映射的段文件中，每个报文按线路格式存放并按8字节对齐，
+// 段写满或打开超过 rollMs 后换新段；数据页由内核按需换出，不占用堆内存
+// 换段所需的建文件、预分配与映射以及旧段的删除由 prepare 在调用方的锁外完成，append 内只做内存拷贝
+// 日志只在本次会话内有效，关闭时删除全部段文件；非线程安全，由调用方加锁
+class SendLog
+{
+public:
+    SendLog();
+    ~SendLog();
+
+    // 在 directory 下创建段文件，rollMs 为0表示只按大小换段
+    bool open(const std::string &directory, size_t segmentBytes = SEND_LOG_SEGMENT_SIZE,
+              int maxSegments = SEND_LOG_MAX_SEGMENTS, int rollMs = 0);
+    void close();
+    bool isOpen() const { return !directory.empty(); }
+
+    // 追加的报文序号 seq 应等于end()，不连续时丢弃已有的段重新开始；写入失败时返回false
+    // 日志中的副本类型改为REPAIR，直接用于补发
+    bool append(int64_t seq, const Message &msg, uint64_t nowMs);
+    // 返回日志中序号为seq的报文，不在 [begin(), end()) 内时返回nullptr
+    // 指针在下一次 append 之前有效
+    const Message *find(int64_t seq) const;
+    // 预先创建并映射下一个段，并删除已退休的段；可在不持有调用方锁时调用，但须与 append 在同一线程
+    // 没有预备段时 append 换段会同步创建
+    void prepare();
+
+    int64_t begin() const { return segments.empty() ? nextSeq : segments.front().firstSeq; }
+    int64_t end() const { return nextSeq; }
+    size_t segmentCount() const { return segments.size(); }
+
+private:
+    struct Segment
+    {
+        int64_t firstSeq;
+        int fd;
+        char *base;
+        size_t used;
+        uint64_t openedMs;
+        std::vector<uint32_t> offsets; // 序号 firstSeq + i 的报文在段内的偏移
+        std::string path;
+
+        Segment() : firstSeq(0), fd(-1), base(nullptr), used(0), openedMs(0) {}
+    };
+
+    bool roll(int64_t firstSeq, uint64_t nowMs);
+    // 最老的段移入 retired，由 prepare 或 close 删除
+    void retire();
+    // 创建、预分配并映射一个空段文件，populate 为true时预先建立页表映射
+    bool createSegment(Segment &segment, bool populate);
+    void destroy(Segment &segment);
+
+    std::string directory;
+    size_t segmentBytes;
+    int maxSegments;
+    int rollMs;
+    int64_t nextSeq;
+    uint64_t createdCount; // 段文件按创建顺序编号命名
+    std::deque<Segment> segments;
+    Segment spare; // base 为nullptr表示没有预备段
+    std::vector<Segment> retired;
+};
+
+#endif // SENDLOG_H
@@ -0,0 +1,84 @@
+#ifndef SENDWINDOW_H
+#define SENDWINDOW_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+// 发送窗口：容量为2的幂的环形缓冲，按序号 & mask 直接定位
+// 窗口内序号连续，区间为 [begin(), end())，序号为64位逻辑序号
+template <typename T>
+class SendWindow
+{
+public:
+    // 容量向上取整为2的幂，槽位以 init 预先填充，稳态下不再分配内存
+    SendWindow(int capacity, const T &init)
+        : slots(roundUp(std::max(capacity, 1)), init), head(0), tail(0)
+    {
+        mask = static_cast<int>(slots.size()) - 1;
+    }
+
+    bool empty() const { return head == tail; }
+    bool full() const { return tail - head == static_cast<int>(slots.size()); }
+    int size() const { return static_cast<int>(tail - head); }
+    int capacity() const { return static_cast<int>(slots.size()); }
+
+    // 最老的未确认序号
+    int64_t begin() const { return head; }
+    // 下一个入队的序号
+    int64_t end() const { return tail; }
+
+    bool contains(int64_t seq) const { return seq >= head && seq < tail; }
+    T &at(int64_t seq) { return slots[seq & mask]; }
+    const T &at(int64_t seq) const { return slots[seq & mask]; }
+
+    // 仅在窗口为空时调用，从 seq 开始编号
+    void reset(int64_t seq)
+    {
+        head = seq;
+        tail = seq;
+    }
+
+    // 返回序号为end()的槽位供原地写入，窗口已满时返回nullptr
+    // 写入完成后调用commit()入队，之前该槽位对窗口不可见
+    T *prepare()
+    {
+        return full() ? nullptr : &slots[tail & mask];
+    }
+
+    void commit()
+    {
+        tail++;
+    }
+
+    // 释放所有序号 <= seq 的消息，只移动头指针，O(1)
+    void releaseUpTo(int64_t seq)
+    {
+        if (seq >= tail)
+        {
+            seq = tail - 1;
+        }
+        if (seq >= head)
+        {
+            head = seq + 1;
+        }
+    }
+
+private:
+    static int roundUp(int n)
+    {
+        int size = 1;
+        while (size < n)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<T> slots;
+    int64_t mask;
+    int64_t head;
+    int64_t tail;
+};
+
+#endif // SENDWINDOW_H
@@ -0,0 +1,45 @@
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include "Reactor.h"
+
+// 会话管理器：固定数量的事件循环线程承载任意多个收发会话
+// 线程数按CPU核数设置，与组播组数量无关；会话创建时分配到当前会话最少的线程
+// 所有会话必须在管理器停止前停止
+class SessionManager
+{
+public:
+    // threadCount 为0时使用CPU核数
+    explicit SessionManager(int threadCount = 0);
+    ~SessionManager();
+
+    void start();
+    void stop();
+
+    // 为新会话选择事件循环，会话销毁时需调用 release
+    Reactor *acquire();
+    void release(Reactor *reactor);
+
+    int threadCount() const { return static_cast<int>(workers.size()); }
+    // 各线程当前承载的会话数
+    std::vector<int> sessionCounts() const;
+
+private:
+    struct Worker
+    {
+        Reactor reactor;
+        std::thread thread;
+        std::atomic<int> sessions;
+
+        Worker() : sessions(0) {}
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<bool> running;
+};
+
+#endif // SESSIONMANAGER_H
@@ -0,0 +1,129 @@
+#ifndef SIMNETWORK_H
+#define SIMNETWORK_H
+
+#include <string>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <random>
+#include <cstdint>
+#include "Transport.h"
+
+// 网络损伤参数，对每个目的端点独立生效，单播与组播报文同样适用
+struct SimConfig
+{
+    double lossRate;      // 随机丢包概率
+    double burstStart;    // 每个报文从正常状态进入突发丢包状态的概率
+    double burstEnd;      // 突发丢包状态下每个报文恢复正常的概率，突发期间全部丢弃
+    double reorderRate;   // 报文被额外延迟 reorderDelayUs、从而被后续报文超过的概率
+    int reorderDelayUs;
+    double duplicateRate; // 报文被重复投递的概率
+    int delayUs;          // 固定单向时延
+    int jitterUs;         // 在固定时延上叠加 [0, jitterUs] 的均匀抖动
+    double linkBytesPerSec; // 每个目的端点入口链路的带宽，报文按带宽排队，0表示不限
+    int queueBytes;       // 入口链路的队列容量，排队超过该字节数时尾部丢弃
+    unsigned seed;        // 随机数种子，相同种子与相同发送序列得到相同的损伤序列
+
+    SimConfig();
+};
+
+// 网络收发统计
+struct SimStats
+{
+    uint64_t sent;       // 发出的报文数，组播按一个计
+    uint64_t delivered;  // 放入端点接收队列的报文数（含重复）
+    uint64_t dropped;
+    uint64_t queueDropped; // 其中因入口链路队列满而丢弃的报文数
+    uint64_t duplicated;
+    uint64_t reordered;
+};
+
+class SimTransport;
+
+// 进程内模拟网络：端点之间按地址投递报文，投递时按 SimConfig 施加损伤
+// 所有端点共用一把锁，网络对象须在所有端点销毁后再销毁
+class SimNetwork
+{
+public:
+    explicit SimNetwork(const SimConfig &config = SimConfig());
+    ~SimNetwork();
+
+    // 创建端点，joinGroup 含义同 UdpTransport；端点的单播地址由网络分配
+    Transport *createTransport(const std::string &multicastAddress, int port, bool joinGroup);
+
+    // 运行中调整损伤参数
+    void setConfig(const SimConfig &config);
+    // 单独设置某个端点的入口带宽，覆盖 SimConfig::linkBytesPerSec，用于模拟个别慢接收方
+    void setLinkRate(Transport *endpoint, double bytesPerSec);
+    SimStats stats();
+
+private:
+    friend class SimTransport;
+
+    struct Packet
+    {
+        uint64_t deliverAt; // steady_clock 纳秒
+        uint64_t order;     // 同一时刻按发送顺序投递
+        struct sockaddr_in from;
+        std::string data;
+
+        bool operator>(const Packet &other) const
+        {
+            return deliverAt != other.deliverAt ? deliverAt > other.deliverAt : order > other.order;
+        }
+    };
+
+    void detach(SimTransport *endpoint);
+    // 以下函数要求已持有 mutex
+    ssize_t send(SimTransport *source, const void *data, size_t length, const struct sockaddr_in &to);
+    void deliver(SimTransport *target, const struct sockaddr_in &from, const void *data, size_t length, uint64_t now);
+    uint64_t delay();
+
+    std::mutex mutex;
+    SimConfig config;
+    SimStats counters;
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> uniform;
+    std::vector<SimTransport *> endpoints;
+    uint32_t nextAddress;
+    uint64_t nextOrder;
+};
+
+// 模拟网络中的端点，用timerfd在最早的报文到期时通知事件循环
+class SimTransport : public Transport
+{
+public:
+    ~SimTransport();
+
+    int fd() const { return timerFd; }
+    const struct sockaddr_in &groupAddress() const { return group; }
+
+    int sendBatch(struct mmsghdr *msgs, int count);
+    int recvBatch(struct mmsghdr *msgs, int count);
+    ssize_t sendTo(const void *data, size_t length, const struct sockaddr_in &to);
+    ssize_t recvFrom(void *buffer, size_t length, struct sockaddr_in *from);
+
+private:
+    friend class SimNetwork;
+
+    SimTransport(SimNetwork *network, const struct sockaddr_in &group, const struct sockaddr_in &local, bool joined);
+
+    // 以下函数要求已持有网络的 mutex
+    // 取出一个到期报文，没有时返回false
+    bool popDue(void *buffer, size_t capacity, size_t *length, struct sockaddr_in *from, uint64_t now);
+    // 按最早的待投递报文重新设置timerfd
+    void rearm();
+
+    SimNetwork *network;
+    struct sockaddr_in group;
+    struct sockaddr_in local;
+    bool joined;
+    int timerFd;
+    uint64_t armedAt; // 当前timerfd的到期时间，0表示未设置
+    bool inBurst;
+    double linkRate;     // 入口带宽，小于0表示使用网络的配置
+    uint64_t linkFreeAt; // 入口链路发送完已排队报文的时刻
+    std::priority_queue<SimNetwork::Packet, std::vector<SimNetwork::Packet>, std::greater<SimNetwork::Packet>> inbox;
+};
+
+#endif // SIMNETWORK_H
@@ -0,0 +1,95 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <algorithm>
+
+// 单生产者单消费者无锁环形队列，push 与 pop 均为wait-free
+// 生产者与消费者各自缓存对方的下标，减少跨核读取共享缓存行
+template <typename T>
+class SpscQueue
+{
+public:
+    // 容量向上取整为2的幂
+    explicit SpscQueue(size_t capacity)
+        : slots(roundUp(capacity)), mask(slots.size() - 1), head(0), cachedTail(0), tail(0), cachedHead(0)
+    {
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+    // 仅生产者调用，队列满时返回false
+    bool push(T &&item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead == slots.size())
+        {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead == slots.size())
+            {
+                return false;
+            }
+        }
+        slots[t & mask] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // 仅消费者调用，最多取出max个元素，返回取出个数
+    size_t pop(T *out, size_t max)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (cachedTail - h < max)
+        {
+            cachedTail = tail.load(std::memory_order_acquire);
+        }
+        size_t n = std::min(cachedTail - h, max);
+        for (size_t i = 0; i < n; ++i)
+        {
+            out[i] = std::move(slots[(h + i) & mask]);
+        }
+        head.store(h + n, std::memory_order_release);
+        return n;
+    }
+
+    // 任意线程可调用，返回近似元素个数
+    size_t size() const
+    {
+        size_t h = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - h;
+    }
+
+    bool empty() const
+    {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    static size_t roundUp(size_t n)
+    {
+        size_t size = 1;
+        while (size < n)
+        {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    std::vector<T> slots;
+    const size_t mask;
+
+    // 消费者独占的缓存行
+    std::atomic<size_t> head;
+    size_t cachedTail;
+    char consumerPad[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    // 生产者独占的缓存行
+    std::atomic<size_t> tail;
+    size_t cachedHead;
+    char producerPad[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+};
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,53 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// 运行统计：计数器与直方图只由所属会话的一个线程（或持锁者）写入，
+// 写入为relaxed的读改写，不使用带锁前缀的原子加；任意线程可随时读取近似快照
+
+// 单写者计数器
+class StatCounter
+{
+public:
+    StatCounter() : value(0) {}
+
+    void add(uint64_t n = 1) { value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+    void set(uint64_t n) { value.store(n, std::memory_order_relaxed); }
+    uint64_t get() const { return value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value;
+};
+
+const int HISTOGRAM_BUCKETS = 32; // 第i个桶统计 [2^(i-1), 2^i)，0单独一个桶，末桶包含所有更大值
+
+struct HistogramSnapshot
+{
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+
+    double mean() const { return count == 0 ? 0.0 : static_cast<double>(sum) / count; }
+    // 第 p (0-1) 分位数所在桶的上界
+    uint64_t percentile(double p) const;
+};
+
+// 固定分桶直方图，按2的幂分桶，记录为O(1)
+class Histogram
+{
+public:
+    void record(uint64_t value);
+    HistogramSnapshot snapshot() const;
+
+private:
+    StatCounter buckets[HISTOGRAM_BUCKETS];
+    StatCounter count;
+    StatCounter sum;
+    StatCounter max;
+};
+
+#endif // STATS_H
@@ -0,0 +1,65 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <functional>
+#include <unordered_map>
+
+// 分层时间轮，精度1毫秒，4层每层256个槽
+// 第0层覆盖256ms，之后每层范围扩大256倍，高层定时器到期前逐级下放到低层
+class TimerWheel
+{
+public:
+    typedef uint64_t TimerId;
+
+    // nowMs 为起始时刻，之后的时间均为同一时钟下的毫秒数
+    explicit TimerWheel(uint64_t nowMs);
+
+    // delayMs 毫秒后执行回调，返回可用于取消的id（从1开始）
+    TimerId schedule(uint64_t delayMs, std::function<void()> callback);
+    bool cancel(TimerId id);
+
+    // 推进到 nowMs 并执行所有到期回调，回调中可以安全地增删定时器
+    // 空槽直接跳过，开销与经过的非空槽和下放次数成正比，而不是与经过的毫秒数成正比
+    void advance(uint64_t nowMs);
+
+    // 距下一次需要推进的毫秒数，无定时器时返回-1
+    // 结果可能早于实际到期时间（高层下放时刻），但不会晚于到期时间
+    int nextTimeout() const;
+
+    bool empty() const { return index.empty(); }
+    size_t size() const { return index.size(); }
+
+private:
+    static const int LEVELS = 4;
+    static const int SLOT_BITS = 8;
+    static const int SLOTS = 1 << SLOT_BITS;
+    static const int FIRING = -1;
+
+    struct Timer
+    {
+        TimerId id;
+        uint64_t expires;
+        std::function<void()> callback;
+        int level;
+        int slot;
+    };
+
+    void place(std::list<Timer> &from, std::list<Timer>::iterator it);
+    void cascade(int level, int slot);
+    void tick();
+    // 本圈内下一个非空的第0层槽距当前的tick数，没有时返回0
+    int nextOccupied() const;
+    void markSlot(int slot, bool occupy);
+
+    std::list<Timer> wheel[LEVELS][SLOTS];
+    uint64_t occupied[SLOTS / 64]; // 第0层非空槽位图
+    std::list<Timer> firing;
+    std::unordered_map<TimerId, std::list<Timer>::iterator> index;
+    uint64_t currentTick;
+    TimerId nextId;
+};
+
+#endif // TIMERWHEEL_H
@@ -0,0 +1,58 @@
+#ifndef TOKENBUCKET_H
+#define TOKENBUCKET_H
+
+#include <cstdint>
+#include <cstddef>
+
+// 发送速率与实际吞吐，单位为每秒
+struct PacingStats
+{
+    double bytesRate;        // 配置的字节速率，0表示不限
+    double packetsRate;      // 配置的报文速率，0表示不限
+    double achievedBytes;    // 最近一个统计周期的实际字节吞吐
+    double achievedPackets;  // 最近一个统计周期的实际报文吞吐
+};
+
+// 令牌桶限速：字节与报文两个桶同时生效，burst为可累积的最大令牌数
+// 默认不限速，只统计吞吐
+class TokenBucket
+{
+public:
+    TokenBucket();
+
+    // 速率为0表示该维度不限速；burst不足一个报文时按一个报文处理
+    void setRate(double bytesPerSec, double packetsPerSec, double burstBytes, double burstPackets);
+    // 运行中调整字节速率与桶容量：按原速率补足令牌到当前时刻，保留已有令牌，报文速率不变
+    void adjustRate(double bytesPerSec, double burstBytes, uint64_t nowUs);
+    bool unlimited() const { return bytesRate <= 0 && packetsRate <= 0; }
+
+    // 令牌足够时扣除并返回true
+    bool tryConsume(size_t bytes, uint64_t nowUs);
+    // 发送 bytes 字节的报文还需等待的微秒数，可立即发送时返回0
+    uint64_t waitTime(size_t bytes, uint64_t nowUs);
+
+    PacingStats stats(uint64_t nowUs);
+
+    static uint64_t nowUs();
+
+private:
+    void refill(uint64_t nowUs);
+    void record(size_t bytes, uint64_t nowUs);
+
+    double bytesRate;
+    double packetsRate;
+    double burstBytes;
+    double burstPackets;
+    double byteTokens;
+    double packetTokens;
+    uint64_t lastRefill;
+
+    // 吞吐统计，每个周期结束时更新
+    uint64_t periodStart;
+    uint64_t periodBytes;
+    uint64_t periodPackets;
+    double achievedBytes;
+    double achievedPackets;
+};
+
+#endif // TOKENBUCKET_H
@@ -0,0 +1,122 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+#include <atomic>
+
+// 二进制协议追踪：每个线程写入自己的无锁环形缓冲，后台线程批量落盘，
+// 由 tools/traceDecode 离线解码为文本
+
+// 编译期过滤级别，低于 TRACE_LEVEL 的埋点在预处理阶段被整体删除
+#define TRACE_LEVEL_DEBUG 0
+#define TRACE_LEVEL_INFO 1
+#define TRACE_LEVEL_WARN 2
+#define TRACE_LEVEL_OFF 3
+
+#ifndef TRACE_LEVEL
+#define TRACE_LEVEL TRACE_LEVEL_INFO
+#endif
+
+// 新事件只能追加在末尾，已落盘的文件按数值解码
+enum TraceEvent
+{
+    TRACE_ENQUEUE,          // 发送端：seq, length
+    TRACE_SEND,             // 发送端：seq, length
+    TRACE_RETRANSMIT,       // 发送端：seq, length
+    TRACE_FEC_SEND,         // 发送端：分组首个seq, 分组报文数
+    TRACE_ACK_REQUEST,      // 发送端：最慢接收方ack, 接收方数
+    TRACE_ACK_RECEIVED,     // 发送端：nodeId, ack
+    TRACE_NACK_RECEIVED,    // 发送端：start, end
+    TRACE_NACK_OUT_WINDOW,  // 发送端：start, end
+    TRACE_RECEIVER_EVICTED, // 发送端：nodeId, ack
+    TRACE_ACK_SENT,         // 接收端：receiverId, ack
+    TRACE_NACK_SENT,        // 接收端：首个空洞起点, 最后一个空洞终点
+    TRACE_NACK_SUPPRESSED,  // 接收端：首个空洞起点, 最后一个空洞终点
+    TRACE_FEC_RECOVERED,    // 接收端：seq, length
+    TRACE_NACK_EXHAUSTED,   // 接收端：start, end
+    TRACE_JOIN_REQUEST,     // 发送端：nodeId, 可补发的最早序号
+    TRACE_JOINED,           // 接收端：起始序号, 发送端最大序号
+    TRACE_EVENT_COUNT
+};
+
+// 定长记录，落盘格式与内存布局一致
+struct TraceRecord
+{
+    uint64_t timestamp; // steady_clock 纳秒
+    uint32_t thread;    // 线程登记序号，从1开始
+    uint16_t event;
+    uint8_t level;
+    uint8_t reserved;
+    int64_t arg0;
+    int64_t arg1;
+};
+
+static_assert(sizeof(TraceRecord) == 32, "TraceRecord must stay 32 bytes");
+
+// 文件头之后紧跟 TraceRecord 序列，各线程的记录按落盘批次交错，解码时按时间戳排序
+struct TraceFileHeader
+{
+    char magic[8]; // "MCTRACE"
+    uint32_t version;
+    uint32_t recordSize;
+};
+
+const uint32_t TRACE_VERSION = 1;
+const int TRACE_BUFFER_SIZE = 8192; // 每个线程的环形缓冲记录数，写满时丢弃新记录
+
+class Trace
+{
+public:
+    // 打开追踪文件并启动落盘线程，失败时返回false
+    static bool open(const std::string &path);
+    // 停止追踪，写出所有缓冲中的记录后关闭文件
+    static void close();
+
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+    static void record(TraceEvent event, int level, int64_t arg0, int64_t arg1);
+    // 因缓冲写满丢弃的记录数
+    static unsigned long long dropped();
+
+    static const char *eventName(uint16_t event);
+    static const char *levelName(uint8_t level);
+
+private:
+    static std::atomic<bool> active;
+};
+
+#define TRACE_AT(level, event, arg0, arg1)                                                   \
+    do                                                                                       \
+    {                                                                                        \
+        if (Trace::enabled())                                                                \
+            Trace::record(event, level, static_cast<int64_t>(arg0), static_cast<int64_t>(arg1)); \
+    } while (0)
+
+#if TRACE_LEVEL <= TRACE_LEVEL_DEBUG
+#define TRACE_DEBUG(event, arg0, arg1) TRACE_AT(TRACE_LEVEL_DEBUG, event, arg0, arg1)
+#else
+#define TRACE_DEBUG(event, arg0, arg1) \
+    do                                 \
+    {                                  \
+    } while (0)
+#endif
+
+#if TRACE_LEVEL <= TRACE_LEVEL_INFO
+#define TRACE_INFO(event, arg0, arg1) TRACE_AT(TRACE_LEVEL_INFO, event, arg0, arg1)
+#else
+#define TRACE_INFO(event, arg0, arg1) \
+    do                                \
+    {                                 \
+    } while (0)
+#endif
+
+#if TRACE_LEVEL <= TRACE_LEVEL_WARN
+#define TRACE_WARN(event, arg0, arg1) TRACE_AT(TRACE_LEVEL_WARN, event, arg0, arg1)
+#else
+#define TRACE_WARN(event, arg0, arg1) \
+    do                                \
+    {                                 \
+    } while (0)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,29 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+// 报文传输接口，发送端与接收端只通过它收发报文
+// 所有操作均为非阻塞；fd() 可读时由事件循环调用接收函数
+class Transport
+{
+public:
+    virtual ~Transport() {}
+
+    // 可读时就绪的文件描述符，注册到 Reactor
+    virtual int fd() const = 0;
+    // 组播组地址，发往该地址的报文投递给所有加入组的端点
+    virtual const struct sockaddr_in &groupAddress() const = 0;
+
+    // 按各自的 msg_name 批量发送，语义同 sendmmsg，返回发出的个数，失败返回-1并设置errno
+    virtual int sendBatch(struct mmsghdr *msgs, int count) = 0;
+    // 批量接收，语义同 recvmmsg(MSG_DONTWAIT)，填写 msg_len 与源地址，无数据时返回0或-1
+    virtual int recvBatch(struct mmsghdr *msgs, int count) = 0;
+
+    virtual ssize_t sendTo(const void *data, size_t length, const struct sockaddr_in &to) = 0;
+    virtual ssize_t recvFrom(void *buffer, size_t length, struct sockaddr_in *from) = 0;
+};
+
+#endif // TRANSPORT_H
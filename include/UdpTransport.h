@@ -0,0 +1,30 @@
+#ifndef UDPTRANSPORT_H
+#define UDPTRANSPORT_H
+
+#include <string>
+#include "Transport.h"
+
+const int UDP_RECV_BUFFER = 4 << 20; // 接收端套接字缓冲区字节数，实际大小受 net.core.rmem_max 限制
+
+// UDP组播传输
+class UdpTransport : public Transport
+{
+public:
+    // joinGroup 为true时绑定端口并加入组播组（接收端），否则只向组播组发送并接收单播回复（发送端）
+    UdpTransport(const std::string &multicastAddress, int port, bool joinGroup);
+    ~UdpTransport();
+
+    int fd() const { return sockfd; }
+    const struct sockaddr_in &groupAddress() const { return group; }
+
+    int sendBatch(struct mmsghdr *msgs, int count);
+    int recvBatch(struct mmsghdr *msgs, int count);
+    ssize_t sendTo(const void *data, size_t length, const struct sockaddr_in &to);
+    ssize_t recvFrom(void *buffer, size_t length, struct sockaddr_in *from);
+
+private:
+    int sockfd;
+    struct sockaddr_in group;
+};
+
+#endif // UDPTRANSPORT_H
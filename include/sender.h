@@ -14,91 +14,281 @@
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
-#include <sys/select.h>
+#include <sys/eventfd.h>
 #include <mutex>
 #include <algorithm>
+#include <functional>
+#include <atomic>
+#include <limits>
+#include <cerrno>
+#include "Protocol.h"
+#include "Trace.h"
+#include "SendWindow.h"
+#include "Reactor.h"
+#include "SessionManager.h"
+#include "TokenBucket.h"
+#include "UdpTransport.h"
+#include "ReceiverTable.h"
+#include "SendLog.h"
+#include "RateController.h"
+#include "Stats.h"
 
-enum MessageType
-{
-    INIT,
-    DATA,
-    ACK,
-    NACK,
-    ACK_REQUEST,
-    REPAIR
-};
+const int SEND_COUNT = 50;        // 每轮最多发送的包数
+const int SEND_ACK_COUNT = 100;   // 未确认包数达到该值时请求ACK
+const int EVICT_TIMEOUT_MS = 3000; // 落后的接收方ack停滞、未发NACK且缺失报文无补包在途超过该毫秒数时被踢除，
+                                   // 须大于接收方NACK重试间隔（nackTimeout）与ACK请求间隔之和
+const double ackTimeout = 1.0;    // ACK请求间隔（秒）
+const int SEND_BATCH_SIZE = 16;   // 单次sendmmsg默认携带的报文数
+const int MAX_SEND_BATCH = 64;    // 单次sendmmsg最多携带的报文数
+const int SEND_WINDOW_SIZE = 4096; // 默认发送窗口容量，需为2的幂；接收方重排窗口（REORDER_WINDOW_SIZE）须不小于该值，
+                                   // 否则丢包后发送端会越过接收方窗口，其后的报文全部超出窗口被丢弃，只能靠NACK补回
+const int MAX_FEC_BLOCK = 255;    // FEC分组最多包含的DATA报文数
+const int FEC_FLUSH_DELAY = 10;   // 发送空闲时未满分组等待该毫秒数后提前发出校验
+const int REPAIR_HOLDDOWN = 50;   // 同一序号在该毫秒数内最多补发一次，期间的重复NACK被忽略
+const int RATE_BURST_MS = 10;     // 速率控制下令牌桶最多累积该毫秒数的发送量
+const int COALESCE_RECORD_HEADER = sizeof(uint16_t); // 合并报文中每条消息前的长度字段
 
-struct Message
+// 批量发送统计，节省的系统调用数为 datagrams - syscalls
+struct BatchStats
 {
-    MessageType type;
-    int sequenceNumber;
-    char content[256];
-    int nodeId;
-
-    Message(MessageType type, int seq, int id, const std::string &msg)
-        : type(type), sequenceNumber(seq), nodeId(0)
-    {
-        strncpy(content, msg.c_str(), sizeof(content));
-    }
+    unsigned long long batches;   // 刷新的批次数
+    unsigned long long syscalls;  // sendmmsg调用次数
+    unsigned long long datagrams; // 成功发出的报文数
 };
 
-struct ReceiverNode
+// 零拷贝发送缓冲，指向发送窗口中的槽位，提交后由窗口持有直至被ACK
+struct SendBuffer
 {
-    int ackSequenceNumber;
-    int nodeId;
-
-    ReceiverNode(int ack, int id);
-
-    bool operator==(const ReceiverNode &other) const;
+    char *data;          // 负载写入位置
+    size_t capacity;     // 最多可写入的字节数
+    int64_t sequenceNumber; // 提交后使用的序号
 };
 
-// 定义回调事件类型枚举
-enum EventType
+// 发送端运行统计快照，计数器为累计值，gauge为读取时刻的近似值
+struct SenderStats
 {
-    INQUEUE_ERROR,
-    NACK_OUT_QUEUE
-};
+    uint64_t messagesEnqueued;   // 入队的报文数（分片各计一次，合并的消息各计一次）
+    uint64_t messagesCoalesced;  // 并入已有报文、未单独占用报文的消息数
+    uint64_t packetsSent;        // 首次发出的DATA报文数
+    uint64_t bytesSent;          // 首次发出的报文字节数（含报文头）
+    uint64_t repairsSent;        // 重传的报文数
+    uint64_t logRepairsSent;     // 其中由发送日志补发的报文数
+    uint64_t parityPacketsSent;  // FEC校验报文数
+    uint64_t acksReceived;
+    uint64_t ackRequestsSent;
+    uint64_t nacksReceived;
+    uint64_t nackRangesRejected; // 超出发送窗口的NACK区间数
+    uint64_t receiversEvicted;   // 因停滞超过 EVICT_TIMEOUT_MS 或缺失报文已无法补发而被踢除的接收方数
 
-struct Event
-{
-    EventType type;      // 事件类型
-    std::string message; // 事件消息内容
+    uint64_t receivers;          // gauge：接收方表大小
+    uint64_t windowOccupancy;    // gauge：发送窗口中未确认的报文数
+    uint64_t windowCapacity;
+    uint64_t unsentPackets;      // gauge：已入队尚未首次发出的报文数
+    uint64_t repairBacklog;      // gauge：重传队列中待补发的报文数
+    uint64_t logPackets;         // gauge：发送日志中保存的报文数
+    uint64_t sendRate;           // gauge：速率控制给出的当前速率（字节/秒），未启用时为0
+    int64_t limitingReceiver;    // gauge：决定当前速率的接收方，-1表示无
+
+    BatchStats batch;
+    HistogramSnapshot repairLatencyUs; // 收到NACK到补包发出的时间（微秒）
+    HistogramSnapshot windowSize;      // 每轮发送时的窗口占用
 };
 
 class MulticastSender
 {
 public:
-    MulticastSender(const std::string &multicastAddress, int port);
+    // windowSize 为重传窗口容量，向上取整为2的幂，不应超过接收方的重排窗口容量
+    // 独占一个事件循环线程
+    MulticastSender(const std::string &multicastAddress, int port, int windowSize = SEND_WINDOW_SIZE);
+    // 由会话管理器的共享事件循环驱动，不单独创建线程
+    MulticastSender(const std::string &multicastAddress, int port, SessionManager &manager,
+                    int windowSize = SEND_WINDOW_SIZE);
+    // 使用指定的传输（如 SimNetwork 的端点），transport 须为发送端角色
+    explicit MulticastSender(std::unique_ptr<Transport> transport, int windowSize = SEND_WINDOW_SIZE);
+    MulticastSender(std::unique_ptr<Transport> transport, SessionManager &manager, int windowSize = SEND_WINDOW_SIZE);
     ~MulticastSender();
 
+    // 超过单个报文负载的消息按分片发送，所有分片须能同时放入窗口
     bool sendMessage(const std::string &message);
+    bool sendMessage(const char *data, size_t length);
+
+    // 零拷贝发送：reserve 预留窗口槽位，调用方直接写入 buffer.data，
+    // 再以实际长度 commit；同一时刻只允许一个预留，窗口已满时返回false
+    bool reserve(SendBuffer &buffer);
+    bool commit(const SendBuffer &buffer, size_t length);
+    void cancel(const SendBuffer &buffer);
 
+    // 回调在发送线程或调用 sendMessage/reserve 的线程中执行，调用时不持有内部锁，可在回调中再次调用发送接口
     void setCallback(std::function<void(const Event &)> cb);
+    // 设置单次sendmmsg携带的报文数，需在start前调用
+    void setBatchSize(int size);
+    BatchStats getBatchStats() const;
+    // 设置单个报文的最大负载，用于适配路径MTU，需在start前调用
+    void setMaxPayload(int bytes);
+    // 设置令牌桶发送速率，新数据与补包共用，速率为0表示该维度不限速，可在运行中调整
+    void setPacing(double bytesPerSec, double packetsPerSec, double burstBytes, double burstPackets);
+    // 当前配置速率与实际吞吐
+    PacingStats getPacingStats();
+    // 启用基于接收方反馈的速率控制：每次ACK交换时按ACK进展、NACK频率与RTT调整令牌桶的字节速率，
+    // 之后 setPacing 设置的字节速率被覆盖，报文速率仍然生效；需在start前调用
+    void setRateControl(const RateConfig &config);
+    // 当前速率与限速的接收方
+    RateControlStats getRateStats();
+    // 可在任意线程调用，不加锁，不影响收发
+    SenderStats getStats() const;
+    // 每 blockSize 个DATA报文附加一个异或校验报文，冗余率为 1/blockSize，0表示关闭
+    // 启用后单个报文负载上限降为 MAX_FEC_PAYLOAD_SIZE，需在start前调用
+    void setFec(int blockSize);
+    // 合并小消息：连续的小消息装入同一个报文，直至负载达到 maxBytes（不超过单个报文负载），
+    // 未满的报文最多等待 holdMs 毫秒后发出；每条消息有独立的消息序号，补包以整个报文为单位
+    // maxBytes 为0表示关闭，需在start前调用
+    void setCoalescing(int maxBytes, int holdMs);
+    // 设置首个报文的序号与消息序号，默认从0开始，需在start前且尚未发送消息时调用
+    void setInitialSequence(int64_t seq);
+    // 启用发送日志：被窗口释放的报文追加到 directory 下的内存映射段文件，
+    // 超出窗口的NACK由日志补发；段写满或打开超过 rollMs 后换段，最多保留 maxSegments 段
+    // 需在start前调用，目录无法创建时返回false
+    bool setSendLog(const std::string &directory, size_t segmentBytes = SEND_LOG_SEGMENT_SIZE,
+                    int maxSegments = SEND_LOG_MAX_SEGMENTS, int rollMs = 0);
 
     void start();
     void stop();
 
 private:
+    MulticastSender(std::unique_ptr<Transport> transport, SessionManager *manager, int windowSize);
+
     void run();
+    // 在事件循环中注册与注销套接字、定时器
+    void attach();
+    void detach();
+    // 以下函数均在事件循环线程中执行
+    void onReadable();
+    void onFlush();
+    void onAckTimer();
+    // 唤醒事件循环发送新入队的消息，可在任意线程调用
+    void notifyPending();
+    // 发送后按需安排续发与ACK请求，delayMs < 0 表示无待发送数据
+    void scheduleAfterSend(int delayMs);
 
+    // 按ack仍在窗口内的接收方中最慢者释放窗口，检查最慢的接收方是否应被踢除，并组播ACK请求
     void requestACK();
     void handleACK(const Message &msg);
+    // 按本轮ACK交换的反馈更新速率控制并调整令牌桶，要求已持有queueMutex
+    void updateRate();
     void handleNACK(const Message &msg);
-    void sendPendingMessages();
-
-    int sockfd;
-    struct sockaddr_in addr;
-    std::string multicastAddress;
-    int port;
-    int sequenceNumber;
-    int lastAckExchange;
-    std::deque<Message>::iterator sendPointer;
-    std::deque<Message> sendQueue;
-    std::unordered_set<ReceiverNode> receiverTable;
+    // 入组请求：登记接收方并组播当前窗口范围
+    void handleJoin(const Message &msg);
+    // 先补包后新数据，受令牌桶限速；返回下次发送需等待的毫秒数，
+    // 只因单轮包数达到上限而停止时返回0，无待发送数据时返回-1
+    int sendPendingMessages();
+    // 发送重传队列中的补包，要求已持有queueMutex；补包全部发出时返回true
+    bool sendRepairs(uint64_t now, int &sendCount);
+    // 接收方落后且已停止恢复（超时或缺失的报文已无法补发），可以踢除，要求已持有queueMutex
+    bool stalled(const ReceiverNode &node) const;
+    // 可补发的最小序号，启用发送日志时包括日志中的报文，要求已持有queueMutex
+    int64_t retainedBegin() const;
+    // 返回可补发的报文，先查窗口再查日志，要求已持有queueMutex
+    const Message *retained(int64_t seq) const;
+    // 将闭区间合并进按序号排序的重传队列，要求已持有queueMutex
+    void queueRepair(int64_t startSeq, int64_t endSeq);
+    // 刷新窗口与队列相关的gauge，要求已持有queueMutex
+    void updateGauges();
+    // 填写窗口槽位的报文头，序号取当前 sequenceNumber，启用合并时消息序号取当前 messageNumber
+    void fillSlot(Message *slot, size_t length, int fragIndex, int fragCount);
+    // 将消息追加到末尾未发出的合并报文，放不下时新开一个，要求已持有queueMutex；窗口已满时返回false
+    bool coalesce(const char *data, size_t length);
+    void addToBatch(const Message &msg);
+    int flushBatch();
+    // 以下FEC函数要求已持有queueMutex
+    // 将首次发出的序号为 seq 的DATA报文累加到当前分组的校验中
+    void foldParity(int64_t seq, const Message &msg);
+    // 结束当前分组，生成待发的校验报文
+    void closeParity();
+    // 发出待发的校验报文，受令牌桶限速；无待发校验时返回true
+    bool sendParity(uint64_t now);
+
+    std::unique_ptr<Transport> transport;
+    struct sockaddr_in addr; // 组播地址
+    // 序号均为64位逻辑序号，报文头中只携带低32位
+    int64_t sequenceNumber;
+    int64_t lastAckExchange;
+    int64_t sendPointer; // 下一个待发送的序号
+    int maxPayload;  // 分片大小
+    bool reserved;   // 是否有未提交的预留槽位
+    // 小消息合并，coalesceOpen 表示窗口末尾的报文仍可追加
+    int coalesceBytes;
+    uint64_t coalesceHoldUs;
+    int64_t messageNumber; // 下一条消息的消息序号
+    bool coalesceOpen;
+    uint64_t coalesceOpenedUs;
+    SendWindow<Message> sendQueue;
+    ReceiverTable receiverTable;
     std::mutex queueMutex;
-    std::chrono::time_point<std::chrono::steady_clock> lastAckTime;
     std::function<void(const Event &)> callback;
 
+    // 批量发送缓冲
+    int batchSize;
+    int batchFill;
+    bool sendBlocked; // 本轮发送因发送缓冲区已满而中止，由queueMutex保护
+    struct mmsghdr batchHdrs[MAX_SEND_BATCH];
+    struct iovec batchIovs[MAX_SEND_BATCH];
+    std::atomic<unsigned long long> batchCount;
+    std::atomic<unsigned long long> syscallCount;
+    std::atomic<unsigned long long> datagramCount;
+
+    // 事件循环与定时器，未使用会话管理器时独占一个Reactor
+    SessionManager *manager;
+    std::unique_ptr<Reactor> ownedReactor;
+    Reactor *reactor;
+    int flushFd;
+    std::atomic<bool> flushPending;
+    TimerWheel::TimerId ackTimer;
+    TimerWheel::TimerId flushTimer;
+    int64_t lastAckRequest; // 上次请求ACK时的发送位置
+
+    // 待重传的闭区间，按序号排序且互不重叠，与新数据一起受发送速率控制
+    std::deque<std::pair<int64_t, int64_t>> repairQueue;
+    // 按 seq & mask 记录每个序号最近一次进入重传队列的时间（微秒）
+    std::vector<std::pair<int64_t, uint64_t>> repairStamps;
+    TokenBucket pacer;
+    RateController rateControl;
+    bool rateControlled;
+    // 窗口之后的补包来源，由queueMutex保护
+    SendLog sendLog;
+
+    // FEC编码状态，fecParity 的负载以 FecHeader 开头
+    int fecBlockSize;
+    int64_t fecBlockStart;
+    int fecBlockFill;
+    int fecMaxLength;
+    bool fecReady; // 校验已生成但尚未发出
+    FecHeader fecAccum;
+    Message fecParity;
+    TimerWheel::TimerId fecTimer;
+
+    // 运行统计，gauge在持有queueMutex时由 updateGauges 刷新
+    StatCounter messagesEnqueued;
+    StatCounter messagesCoalesced;
+    StatCounter packetsSent;
+    StatCounter bytesSent;
+    StatCounter repairsSent;
+    StatCounter logRepairsSent;
+    StatCounter parityPacketsSent;
+    StatCounter acksReceived;
+    StatCounter ackRequestsSent;
+    StatCounter nacksReceived;
+    StatCounter nackRangesRejected;
+    StatCounter receiversEvicted;
+    StatCounter receiverGauge;
+    StatCounter occupancyGauge;
+    StatCounter unsentGauge;
+    StatCounter repairBacklogGauge;
+    StatCounter logGauge;
+    StatCounter rateGauge;
+    StatCounter limitingGauge;
+    Histogram repairLatency;
+    Histogram windowSize;
+
     std::atomic<bool> running;
     std::thread senderThread;
 };
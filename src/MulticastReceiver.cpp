@@ -1,47 +1,79 @@
 #include "MulticastReceiver.h"
 
+MulticastReceiver::MulticastReceiver(const std::string &multicastAddress, int port, int receiverId, int windowSize)
+    : MulticastReceiver(std::unique_ptr<Transport>(new UdpTransport(multicastAddress, port, true)), receiverId, nullptr,
+                        windowSize)
+{
+}
+
 MulticastReceiver::MulticastReceiver(const std::string &multicastAddress, int port, int receiverId,
-                                     std::function<void(const Message &)> callback)
-    : multicastAddress(multicastAddress), port(port), receiverId(receiverId), lastReceived(-1),
-      inNackRecoveryCount(0), isSendNACK(0), skipCountTree(3), callback(nullptr), running(false)
+                                     SessionManager &manager, int windowSize)
+    : MulticastReceiver(std::unique_ptr<Transport>(new UdpTransport(multicastAddress, port, true)), receiverId,
+                        &manager, windowSize)
 {
-    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sockfd < 0)
-    {
-        perror("socket creation failed");
-        exit(EXIT_FAILURE);
-    }
+}
 
+MulticastReceiver::MulticastReceiver(std::unique_ptr<Transport> transport, int receiverId, int windowSize)
+    : MulticastReceiver(std::move(transport), receiverId, nullptr, windowSize)
+{
+}
+
+MulticastReceiver::MulticastReceiver(std::unique_ptr<Transport> transport, int receiverId, SessionManager &manager,
+                                     int windowSize)
+    : MulticastReceiver(std::move(transport), receiverId, &manager, windowSize)
+{
+}
+
+MulticastReceiver::MulticastReceiver(std::unique_ptr<Transport> transport, int receiverId, SessionManager *manager,
+                                     int windowSize)
+    : transport(std::move(transport)), recvBuffers(RECV_BATCH_SIZE, Message(INIT, 0, 0, "")),
+      receiverId(receiverId), lastReceived(-1), lastAckExchange(-1), senderHighest(-1), nextMessageNumber(0), joinPolicy(JOIN_OLDEST), joined(false), joinSentMs(0),
+      receiveQueue(DELIVERY_QUEUE_SIZE), consumerWaiting(false), fragmentSeq(-1), nextFragment(0),
+      callback(nullptr), inNackRecoveryCount(0), isSendNACK(0),
+      backoffRng(static_cast<unsigned>(receiverId) ^ static_cast<unsigned>(Reactor::nowMs())), skipWindow(windowSize, Message(INIT, -1, 0, "")),
+      fecActive(false), fecParities(FEC_PARITY_SLOTS, Message(INIT, -1, 0, "")), nackSentUs(0),
+      manager(manager), reactor(nullptr), nackTimer(0), flushTimer(0), running(false)
+{
     memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port);
 
-    if (bind(sockfd, (const struct sockaddr *)&addr, sizeof(addr)) < 0)
+    // 用于唤醒阻塞在 waitData 上的消费者
+    notifyFd = eventfd(0, EFD_NONBLOCK);
+    if (notifyFd < 0)
     {
-        perror("bind failed");
-        close(sockfd);
+        perror("eventfd failed");
         exit(EXIT_FAILURE);
     }
 
-    struct ip_mreq mreq;
-    mreq.imr_multiaddr.s_addr = inet_addr(multicastAddress.c_str());
-    mreq.imr_interface.s_addr = htonl(INADDR_ANY);
-    if (setsockopt(sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+    // 每个接收缓冲对应一个mmsghdr，同时记录报文源地址
+    memset(recvHdrs, 0, sizeof(recvHdrs));
+    for (int i = 0; i < RECV_BATCH_SIZE; ++i)
     {
-        perror("setsockopt failed");
-        close(sockfd);
-        exit(EXIT_FAILURE);
+        recvIovs[i].iov_base = &recvBuffers[i];
+        recvIovs[i].iov_len = sizeof(Message);
+        recvHdrs[i].msg_hdr.msg_iov = &recvIovs[i];
+        recvHdrs[i].msg_hdr.msg_iovlen = 1;
+        recvHdrs[i].msg_hdr.msg_name = &recvAddrs[i];
     }
 
-    // 设置套接字为非阻塞模式
-    int flags = fcntl(sockfd, F_GETFL, 0);
-    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+    if (manager)
+    {
+        reactor = manager->acquire();
+    }
+    else
+    {
+        ownedReactor.reset(new Reactor());
+        reactor = ownedReactor.get();
+    }
 }
 
 MulticastReceiver::~MulticastReceiver()
 {
-    close(sockfd);
+    stop();
+    if (manager)
+    {
+        manager->release(reactor);
+    }
+    close(notifyFd);
 }
 
 // 用于设置回调函数
@@ -50,213 +82,751 @@ void MulticastReceiver::setCallback(std::function<void(const Event &)> cb)
     callback = cb;
 }
 
+void MulticastReceiver::setJoinPolicy(JoinPolicy policy)
+{
+    joinPolicy = policy;
+}
+
+void MulticastReceiver::setDeliveryHandler(int workers, std::function<uint64_t(const ReceivedMessage &)> key,
+                                           std::function<void(ReceivedMessage &)> handler)
+{
+    partitionKey = key;
+    executor.reset(new OrderedExecutor<ReceivedMessage>(workers, DELIVERY_WORKER_QUEUE_SIZE, handler));
+}
+
 void MulticastReceiver::start()
 {
-    running = true;
-    receiverThread = std::thread(&MulticastReceiver::run, this);
+    if (running.exchange(true))
+    {
+        return;
+    }
+    if (executor)
+    {
+        executor->start();
+    }
+    reactor->invoke([this]()
+                    { attach(); });
+    if (ownedReactor)
+    {
+        receiverThread = std::thread(&MulticastReceiver::run, this);
+    }
 }
 
 void MulticastReceiver::stop()
 {
+    if (!running)
+    {
+        return;
+    }
+    // 先在事件循环中注销，之后不会再有回调访问本对象
+    reactor->invoke([this]()
+                    { detach(); });
     running = false;
-    if (receiverThread.joinable())
+    if (ownedReactor)
+    {
+        reactor->wakeup();
+        if (receiverThread.joinable())
+        {
+            receiverThread.join();
+        }
+    }
+    // 网络线程已不再交付，执行完剩余消息后停止工作线程
+    if (executor)
     {
-        receiverThread.join();
+        executor->stop();
     }
 }
 
 void MulticastReceiver::run()
 {
-    fd_set readFds;
+    reactor->run(running);
+}
+
+void MulticastReceiver::attach()
+{
+    reactor->addFd(transport->fd(), EPOLLIN, [this](uint32_t)
+                   { onReadable(); });
+}
+
+void MulticastReceiver::detach()
+{
+    reactor->removeFd(transport->fd());
+    stopRecovery();
+    if (flushTimer != 0)
+    {
+        reactor->cancelTimer(flushTimer);
+        flushTimer = 0;
+    }
+}
+
+void MulticastReceiver::onReadable()
+{
+    // 一次唤醒后批量读取，直到套接字读空
     while (running)
     {
-        FD_ZERO(&readFds);
-        FD_SET(sockfd, &readFds);
+        int n = transport->recvBatch(recvHdrs, RECV_BATCH_SIZE);
+        if (n <= 0)
+        {
+            break;
+        }
+        handleBatch(n);
+        if (n < RECV_BATCH_SIZE)
+        {
+            break;
+        }
+    }
+}
+
+void MulticastReceiver::handleBatch(int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (!recvBuffers[i].isValid(recvHdrs[i].msg_len))
+        {
+            // 丢弃截断或格式错误的报文
+            continue;
+        }
 
-        int ret = select(sockfd + 1, &readFds, nullptr, nullptr, nullptr);
-        if (ret > 0 && FD_ISSET(sockfd, &readFds))
+        // 记录发送方地址，ACK/NACK单播回发送方
+        addr = recvAddrs[i];
+        packetsReceived.add();
+        bytesReceived.add(recvHdrs[i].msg_len);
+        const Message &msg = recvBuffers[i];
+        if (!joined)
+        {
+            handleJoining(msg);
+            continue;
+        }
+        int64_t seq = fromWireSeq(msg.sequenceNumber, lastReceived + 1);
+        switch (msg.type)
         {
-            Message msg(INIT, 0, 0, "");
-            socklen_t len = sizeof(addr);
-            int n = recvfrom(sockfd, &msg, sizeof(msg), 0, (struct sockaddr *)&addr, &len);
-            if (n > 0)
+        case DATA:
+            handleMessage(msg, seq);
+            break;
+        case ACK_REQUEST:
+            sendACK(msg);
+            if (seq > senderHighest)
             {
-                switch (msg.type)
-                {
-                case DATA:
-                    handleMessage(msg);
-                    break;
-                case ACK_REQUEST:
-                    sendACK();
-                    break;
-                case REPAIR:
-                    handleRepair(msg);
-                    break;
-                default:
-                    // processBuffer();
-                    break;
-                }
+                // 超出重排窗口而被丢弃的报文及尾部丢失只能由此发现
+                senderHighest = seq;
+                if (inNackRecoveryCount == 0 && missingData())
+                    checkRecovery();
             }
+            break;
+        case REPAIR:
+            handleRepair(msg, seq);
+            break;
+        case FEC:
+            handleParity(msg);
+            break;
+        case NCF:
+            handleNCF(msg);
+            break;
+        default:
+            break;
         }
-        // else
-        // {
-        //     processBuffer();
-        // }
     }
+
+    if (fecActive)
+    {
+        // 校验先于分组内迟到的报文到达时被暂存，报文到齐后立即重试；若等到NACK计时器到期，
+        // 期间陆续到达的校验会挤掉暂存的校验，空洞只能靠NACK补回
+        retryParities();
+    }
+
+    windowSize.record(skipWindow.size());
+    reorderGauge.set(skipWindow.size());
+
+    // 整批处理完后统一唤醒消费者
+    flushDelivery();
 }
 
-void MulticastReceiver::handleMessage(const Message &msg)
+void MulticastReceiver::handleJoining(const Message &msg)
 {
-    std::lock_guard<std::mutex> lock(queueMutex);
+    if (msg.type == INIT)
+    {
+        // 只用给本接收方的应答：发送端处理本方请求时才按应答中的起始位置登记本方，
+        // 用其他接收方的应答入组时，本方请求可能在窗口越过本方的空洞后才被登记，窗口将停在登记位置无法前进
+        if (msg.nodeId == receiverId)
+        {
+            handleJoin(msg);
+        }
+        return;
+    }
+    if ((msg.type == DATA || msg.type == REPAIR) && static_cast<int>(joinBacklog.size()) < skipWindow.capacity())
+    {
+        joinBacklog.push_back(msg);
+    }
 
-    if (msg.sequenceNumber <= lastReceived)
+    // 收到发送端的报文后才知道其地址，应答丢失时随后续报文重发
+    uint64_t now = Reactor::nowMs();
+    if (joinSentMs == 0 || now - joinSentMs >= static_cast<uint64_t>(JOIN_RETRY_MS))
+    {
+        Message request(INIT, -1, receiverId, "");
+        transport->sendTo(&request, request.wireSize(), addr);
+        joinSentMs = now;
+    }
+}
+
+void MulticastReceiver::handleJoin(const Message &msg)
+{
+    if (msg.length != sizeof(JoinInfo))
     {
-        // 去掉重复的包
         return;
     }
-    else if (msg.sequenceNumber == lastReceived + 1)
+    JoinInfo info;
+    memcpy(&info, msg.content, sizeof(info));
+
+    int64_t start = joinPolicy == JOIN_LIVE ? info.highest + 1 : info.oldest;
+    lastReceived = start - 1;
+    lastAckExchange = lastReceived;
+    senderHighest = info.highest;
+    nextMessageNumber = info.message;
+    skipWindow.reset(start);
+    joined = true;
+    TRACE_INFO(TRACE_JOINED, start, info.highest);
+
+    // 起始序号之前的报文作为重复丢弃，其余按正常路径处理
+    for (const Message &buffered : joinBacklog)
     {
-        receiveQueue.push_back(msg);
-        lastReceived++;
-        // processBuffer();
+        handleMessage(buffered, fromWireSeq(buffered.sequenceNumber, lastReceived + 1));
     }
-    else
+    std::vector<Message>().swap(joinBacklog);
+
+    // 历史部分与缓存之外的缺失由NACK按重排窗口容量分段请求
+    checkRecovery();
+}
+
+bool MulticastReceiver::handleMessage(const Message &msg, int64_t seq)
+{
+    if (seq <= lastReceived)
+    {
+        // 去掉重复的包
+        duplicates.add();
+        return false;
+    }
+    else if (seq == lastReceived + 1 && skipWindow.empty())
     {
-        if (inNackRecoveryCount == 0)
+        // 无乱序状态时按序到达，直接交付
+        if (fecActive)
+        {
+            // 只拷贝有效部分，供之后同一分组的恢复使用
+            memcpy(&skipWindow.slot(seq), &msg, msg.wireSize());
+        }
+        deliver(msg, seq);
+        lastReceived++;
+        skipWindow.reset(lastReceived + 1);
+        if (inNackRecoveryCount != 0)
         {
-            // 第一次乱序到达，将msg放入排序树中，并将标志位置为1，激活乱序定时
-            skipCountTree.insert(msg);
-            inNackRecoveryCount = 1;
-            receiveSkipMsg = std::chrono::steady_clock::now();
+            // 尾部补包按序到达，不经过重排窗口
+            checkRecovery();
         }
+        return true;
+    }
+
+    // 放入重排窗口，重复或超出窗口的包直接丢弃
+    if (!skipWindow.insert(seq, msg))
+    {
+        if (skipWindow.contains(seq))
+            duplicates.add();
         else
+            outOfWindow.add();
+        return false;
+    }
+
+    // 依次取出已连续的包放入队列
+    lastReceived += skipWindow.drain([this](const Message &m, int64_t s)
+                                     { deliver(m, s); });
+    checkRecovery();
+    return true;
+}
+
+bool MulticastReceiver::missingData() const
+{
+    return !skipWindow.empty() || senderHighest > lastReceived;
+}
+
+void MulticastReceiver::checkRecovery()
+{
+    if (!missingData())
+    {
+        // 空洞已补完
+        stopRecovery();
+        return;
+    }
+
+    if (inNackRecoveryCount == 0 || (isSendNACK != 0 && lastReceived >= nackRanges.second))
+    {
+        // 第一次乱序到达或上次NACK的范围已补齐，随机退避后仍有空洞时发送NACK，
+        // 多个接收方同时丢包时先到期者的NACK经发送方NCF抑制其余接收方
+        inNackRecoveryCount = 1;
+        isSendNACK = 0;
+        std::uniform_int_distribution<int> backoff(NACK_BACKOFF_MIN, NACK_BACKOFF_MAX);
+        armNackTimer(backoff(backoffRng));
+    }
+}
+
+void MulticastReceiver::onNackTimer()
+{
+    // 期间到达的数据或补包可能使暂存的校验变得可用，恢复出的消息立即交付
+    retryParities();
+    flushDelivery();
+    if (!missingData())
+    {
+        stopRecovery();
+        return;
+    }
+
+    // 取第一个空洞
+    int64_t gapStart = -1;
+    int64_t gapEnd = -1;
+    skipWindow.forEachGap([&](int64_t start, int64_t end)
+                          {
+        if (gapStart < 0)
         {
-            // 已有乱序状态，将msg放入排序树中，若未超时，则结束处理
-            skipCountTree.insert(msg);
-            auto now = std::chrono::steady_clock::now();
-            std::chrono::duration<double> elapsedSeconds = now - receiveSkipMsg;
+            gapStart = start;
+            gapEnd = end;
+        } });
+    if (gapStart < 0)
+    {
+        // 只有尾部缺失
+        gapStart = lastReceived + 1;
+        gapEnd = senderHighest;
+    }
 
-            // 若超时，则从树中读取数据，依次放入队列中
-            if (elapsedSeconds.count() >= nackTimeout)
+    if (isSendNACK != 0 && lastReceived < nackRanges.second && gapStart <= nackRanges.second)
+    {
+        // 上次NACK的范围仍未补齐，重发并计数
+        inNackRecoveryCount++;
+        if (inNackRecoveryCount == NACK_MAX_RETRIES + 1)
+        {
+            TRACE_WARN(TRACE_NACK_EXHAUSTED, gapStart, gapEnd);
+            nackRetriesExhausted.add();
+            // 回调应用处理
+            if (callback)
+                callback(Event{NACK_ERROR, "NACK retries exhausted for " + std::to_string(gapStart) + " - " +
+                                               std::to_string(gapEnd)});
+        }
+    }
+    else
+    {
+        inNackRecoveryCount = 1;
+    }
+
+    // 一个NACK携带窗口中的全部空洞，记录发送状态并重新计时
+    sendNACK();
+    isSendNACK = 1;
+    armNackTimer(static_cast<uint64_t>(nackTimeout * 1000));
+}
+
+void MulticastReceiver::armNackTimer(uint64_t delayMs)
+{
+    if (nackTimer != 0)
+    {
+        reactor->cancelTimer(nackTimer);
+    }
+    nackTimer = reactor->runAfter(delayMs, [this]()
+                                  {
+        nackTimer = 0;
+        onNackTimer(); });
+}
+
+void MulticastReceiver::stopRecovery()
+{
+    if (nackTimer != 0)
+    {
+        reactor->cancelTimer(nackTimer);
+        nackTimer = 0;
+    }
+    inNackRecoveryCount = 0;
+    isSendNACK = 0;
+}
+
+void MulticastReceiver::deliver(const Message &msg, int64_t seq)
+{
+    int64_t number = seq;
+    if (msg.flags & MESSAGE_NUMBERED)
+    {
+        number = fromWireSeq(static_cast<uint32_t>(msg.nodeId), nextMessageNumber);
+        nextMessageNumber = number + 1;
+    }
+
+    if (msg.flags & MESSAGE_BATCH)
+    {
+        // 逐条拆出合并的消息，消息序号依次递增
+        size_t offset = 0;
+        while (offset + sizeof(uint16_t) <= msg.length)
+        {
+            uint16_t length;
+            memcpy(&length, msg.content + offset, sizeof(length));
+            offset += sizeof(length);
+            if (offset + length > msg.length)
             {
-                Message minMsg = skipCountTree.getMin();
-                while (!skipCountTree.isEmpty() && minMsg.sequenceNumber >= lastReceived)
-                {
-                    if (minMsg.sequenceNumber == lastReceived + 1)
-                    {
-                        receiveQueue.push_back(minMsg);
-                        lastReceived++;
-                        skipCountTree.deleteMin();
-                    }
-                    else if (minMsg.sequenceNumber <= lastReceived)
-                    {
-                        // 去掉重复的包
-                        skipCountTree.deleteMin();
-                    }
-                    else
-                    {
-                        // 发现空洞
-                        break;
-                    }
-                }
-
-                if (skipCountTree.isEmpty())
-                {
-                    // 树中至少有一个跳包，此时已补完
-                    inNackRecoveryCount = 0;
-                    isSendNACK = 0;
-                }
-                else if (isSendNACK != 0)
-                {
-                    if (lastReceived >= nackRanges.second)
-                    {
-                        inNackRecoveryCount = 0;
-                        isSendNACK = 0;
-                    }
-                    else
-                    {
-                        // 回调应用处理
-                    }
-                }
-                else
-                {
-                    // 发送NACK，记录发送状态并重置定时器
-                    sendNACK(lastReceived + 1, minMsg.sequenceNumber - 1);
-                    isSendNACK = 1;
-                    receiveSkipMsg = std::chrono::steady_clock::now();
-                }
+                break;
             }
+            enqueue(ReceivedMessage{number++, std::string(msg.content + offset, length)});
+            offset += length;
         }
+        nextMessageNumber = number;
+        return;
+    }
+
+    if (msg.fragCount <= 1)
+    {
+        enqueue(ReceivedMessage{number, msg.text()});
+        return;
+    }
+
+    if (msg.fragIndex == 0)
+    {
+        fragmentBuffer.clear();
+        fragmentSeq = number;
+        nextFragment = 0;
+    }
+    else if (msg.fragIndex != nextFragment || fragmentSeq < 0)
+    {
+        // 缺少前面的分片（如中途加入），丢弃整条消息
+        fragmentSeq = -1;
+        return;
+    }
+
+    fragmentBuffer.append(msg.content, msg.length);
+    nextFragment++;
+
+    if (nextFragment == msg.fragCount)
+    {
+        enqueue(ReceivedMessage{fragmentSeq, std::move(fragmentBuffer)});
+        fragmentBuffer.clear();
+        fragmentSeq = -1;
+    }
+}
+
+void MulticastReceiver::enqueue(ReceivedMessage &&msg)
+{
+    messagesDelivered.add();
+    if (executor)
+    {
+        uint64_t key = partitionKey(msg);
+        executor->submit(key, std::move(msg));
+        return;
+    }
+    // 已有溢出消息时必须排在其后，保证交付顺序
+    if (!overflowQueue.empty() || !receiveQueue.push(std::move(msg)))
+    {
+        overflowQueue.push_back(std::move(msg));
+    }
+}
+
+void MulticastReceiver::flushDelivery()
+{
+    size_t backlog;
+    if (executor)
+    {
+        executor->flush();
+        backlog = executor->backlog();
+    }
+    else
+    {
+        while (!overflowQueue.empty() && receiveQueue.push(std::move(overflowQueue.front())))
+        {
+            overflowQueue.pop_front();
+        }
+        backlog = overflowQueue.size();
+
+        // 与 waitData 中的 consumerWaiting 写入配对，避免丢失唤醒
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumerWaiting.load(std::memory_order_relaxed) && !receiveQueue.empty())
+        {
+            uint64_t one = 1;
+            ssize_t n = write(notifyFd, &one, sizeof(one));
+            (void)n;
+        }
+    }
+    overflowGauge.set(backlog);
+
+    // 消费方腾出队列空间时不会通知网络线程，有暂存消息时定时重试，不依赖后续报文到达
+    if (backlog > 0 && flushTimer == 0)
+    {
+        flushTimer = reactor->runAfter(DELIVERY_RETRY_MS, [this]()
+                                       {
+            flushTimer = 0;
+            flushDelivery(); });
     }
 }
 
-// void MulticastReceiver::processBuffer()
-// {
-//     std::lock_guard<std::mutex> lock(queueMutex);
-//     // 按顺序处理消息
-//     auto it = receiveQueue.begin();
-//     while (it != receiveQueue.end())
-//     {
-//         callback(*it);
-//         lastReceived = it->sequenceNumber;
-//         it = receiveQueue.erase(it);
-//     }
-// }
+bool MulticastReceiver::getData(ReceivedMessage &msg)
+{
+    return receiveQueue.pop(&msg, 1) == 1;
+}
 
-Message MulticastReceiver::getData()
+int MulticastReceiver::drain(ReceivedMessage *batch, int max)
 {
-    std::lock_guard<std::mutex> lock(queueMutex);
+    return static_cast<int>(receiveQueue.pop(batch, max));
+}
 
+bool MulticastReceiver::waitData(int timeoutMs)
+{
     if (!receiveQueue.empty())
     {
-        Message frontMessage = receiveQueue.front();
-        receiveQueue.pop_front();
-        return frontMessage;
+        return true;
+    }
+
+    consumerWaiting.store(true, std::memory_order_seq_cst);
+    if (receiveQueue.empty())
+    {
+        struct pollfd pfd;
+        pfd.fd = notifyFd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, timeoutMs) > 0)
+        {
+            uint64_t value;
+            ssize_t n = read(notifyFd, &value, sizeof(value));
+            (void)n;
+        }
+    }
+    consumerWaiting.store(false, std::memory_order_relaxed);
+    return !receiveQueue.empty();
+}
+
+void MulticastReceiver::handleRepair(const Message &msg, int64_t seq)
+{
+    // 补包为组播，由其他接收方的NACK触发的补包同样可以填补本地空洞
+    if (handleMessage(msg, seq))
+    {
+        nackRecovered.add();
+        if (nackSentUs != 0)
+        {
+            repairLatency.record(Reactor::nowUs() - nackSentUs);
+        }
     }
-    return NULL;
 }
 
-void MulticastReceiver::handleRepair(const Message &msg)
+void MulticastReceiver::handleNCF(const Message &msg)
 {
-    if (isSendNACK == 0)
+    NackHeader header;
+    // 存在尾部缺失时NCF无法说明其已被请求，仍自行发送NACK
+    if (skipWindow.empty() || senderHighest > skipWindow.highestSeq() || !parseNack(msg, header))
         return;
 
-    if (msg.sequenceNumber < nackRanges.first || msg.sequenceNumber > nackRanges.second)
+    // NCF区间与本地空洞均按序号递增，逐一检查每个空洞是否被某个区间覆盖
+    int index = 0;
+    int64_t spanStart = -1;
+    int64_t spanEnd = -1;
+    bool covered = true;
+    int64_t reference = lastReceived + 1;
+    auto rangeStart = [&](int i)
+    { return fromWireSeq(nackRange(msg, i).start, reference); };
+    auto rangeEnd = [&](int i)
+    { return fromWireSeq(nackRange(msg, i).end, reference); };
+    skipWindow.forEachGap([&](int64_t start, int64_t end)
+                          {
+        if (!covered)
+            return;
+        while (index < header.rangeCount && rangeEnd(index) < start)
+            index++;
+        if (index == header.rangeCount || rangeStart(index) > start || rangeEnd(index) < end)
+        {
+            covered = false;
+            return;
+        }
+        if (spanStart < 0)
+            spanStart = start;
+        spanEnd = end; });
+
+    if (!covered || spanStart < 0)
+        return;
+    if (isSendNACK != 0 && spanStart >= nackRanges.first && spanEnd <= nackRanges.second)
+        // 已发出过覆盖这些空洞的NACK
         return;
 
-    handleMessage(msg);
+    // 视同已发送NACK，等待补包超时后再自行NACK
+    TRACE_INFO(TRACE_NACK_SUPPRESSED, spanStart, spanEnd);
+    nacksSuppressed.add();
+    nackSentUs = Reactor::nowUs();
+    nackRanges.first = spanStart;
+    nackRanges.second = spanEnd;
+    isSendNACK = 1;
+    armNackTimer(static_cast<uint64_t>(nackTimeout * 1000));
 }
 
-void MulticastReceiver::sendACK()
+void MulticastReceiver::handleParity(const Message &parity)
 {
-    Message msg(ACK, lastAckExchange, receiverId, "");
-    sendto(sockfd, &msg, sizeof(msg), 0, (const struct sockaddr *)&addr, sizeof(addr));
-    std::cout << "Sent ACK: " << msg.sequenceNumber << std::endl;
+    fecActive = true;
+    if (recoverFromParity(parity))
+    {
+        return;
+    }
+
+    // 缺失多于一个，暂存等待NACK补回其余报文后再试，优先替换已无用的槽位
+    Message *slot = &fecParities[0];
+    for (Message &stored : fecParities)
+    {
+        if (stored.type != FEC)
+        {
+            slot = &stored;
+            break;
+        }
+        if (wireSeqBefore(stored.sequenceNumber, slot->sequenceNumber))
+        {
+            slot = &stored;
+        }
+    }
+    memcpy(slot, &parity, parity.wireSize());
 }
 
-void MulticastReceiver::sendNACK(int startSeq, int endSeq)
+bool MulticastReceiver::recoverFromParity(const Message &parity)
 {
-    Message msg(NACK, 0, receiverId, std::to_string(startSeq) + " " + std::to_string(endSeq));
-    sendto(sockfd, &msg, sizeof(msg), 0, (const struct sockaddr *)&addr, sizeof(addr));
-    std::cout << "Sent NACK for range: " << startSeq << " - " << endSeq << std::endl;
-    nackRanges.first = startSeq;
-    nackRanges.second = endSeq;
+    int64_t base = fromWireSeq(parity.sequenceNumber, lastReceived + 1);
+    int64_t end = base + parity.fragCount;
+    if (parity.length < FEC_HEADER_SIZE || end - 1 <= lastReceived)
+    {
+        return true;
+    }
+
+    int64_t missing = -1;
+    for (int64_t seq = base; seq < end; ++seq)
+    {
+        if (seq > lastReceived && !skipWindow.contains(seq))
+        {
+            if (missing >= 0)
+            {
+                return false;
+            }
+            missing = seq;
+        }
+        else if (skipWindow.find(seq) == nullptr)
+        {
+            // 已交付但未保留或已被覆盖，无法恢复
+            return true;
+        }
+    }
+    if (missing < 0)
+    {
+        return true;
+    }
+
+    // 校验与分组内其余报文逐一异或得到缺失报文
+    FecHeader fec;
+    memcpy(&fec, parity.content, FEC_HEADER_SIZE);
+    size_t xorLength = parity.length - FEC_HEADER_SIZE;
+    Message rebuilt(DATA, missing, 0, parity.content + FEC_HEADER_SIZE, xorLength);
+    for (int64_t seq = base; seq < end; ++seq)
+    {
+        if (seq == missing)
+        {
+            continue;
+        }
+        const Message *m = skipWindow.find(seq);
+        fec.lengthXor ^= m->length;
+        fec.fragIndexXor ^= m->fragIndex;
+        fec.fragCountXor ^= m->fragCount;
+        fec.flagsXor ^= m->flags;
+        fec.nodeIdXor ^= m->nodeId;
+        xorBytes(rebuilt.content, m->content, std::min<size_t>(m->length, xorLength));
+    }
+    if (fec.lengthXor > xorLength || fec.fragIndexXor >= fec.fragCountXor)
+    {
+        return true;
+    }
+    rebuilt.length = fec.lengthXor;
+    rebuilt.fragIndex = fec.fragIndexXor;
+    rebuilt.fragCount = fec.fragCountXor;
+    rebuilt.flags = static_cast<uint8_t>(fec.flagsXor);
+    rebuilt.nodeId = fec.nodeIdXor;
+
+    if (handleMessage(rebuilt, missing))
+    {
+        TRACE_INFO(TRACE_FEC_RECOVERED, missing, rebuilt.length);
+        fecRecovered.add();
+    }
+    return true;
 }
 
-int main()
+void MulticastReceiver::retryParities()
 {
-    auto callback = [](const Message &msg)
+    for (Message &stored : fecParities)
     {
-        std::cout << "Processing message: " << msg.sequenceNumber << ": " << msg.content << std::endl;
-    };
+        if (stored.type == FEC && recoverFromParity(stored))
+        {
+            stored.type = INIT;
+        }
+    }
+}
+
+RecoveryStats MulticastReceiver::getRecoveryStats() const
+{
+    RecoveryStats stats;
+    stats.fecRecovered = fecRecovered.get();
+    stats.nackRecovered = nackRecovered.get();
+    return stats;
+}
 
-    MulticastReceiver receiver("239.255.0.1", 30001, 1);
+ReceiverStats MulticastReceiver::getStats() const
+{
+    ReceiverStats stats;
+    stats.packetsReceived = packetsReceived.get();
+    stats.bytesReceived = bytesReceived.get();
+    stats.duplicates = duplicates.get();
+    stats.outOfWindow = outOfWindow.get();
+    stats.messagesDelivered = messagesDelivered.get();
+    stats.acksSent = acksSent.get();
+    stats.nacksSent = nacksSent.get();
+    stats.nacksSuppressed = nacksSuppressed.get();
+    stats.nackRetriesExhausted = nackRetriesExhausted.get();
+    stats.fecRecovered = fecRecovered.get();
+    stats.nackRecovered = nackRecovered.get();
+    stats.reorderDepth = reorderGauge.get();
+    stats.deliveryBacklog = receiveQueue.size() + overflowGauge.get();
+    stats.messagesHandled = 0;
+    if (executor)
+    {
+        stats.deliveryBacklog += executor->pending();
+        stats.messagesHandled = executor->completed();
+    }
+    stats.repairLatencyUs = repairLatency.snapshot();
+    stats.windowSize = windowSize.snapshot();
+    return stats;
+}
 
-    receiver.start();
+void MulticastReceiver::sendACK(const Message &request)
+{
+    lastAckExchange = lastReceived;
+    Message msg(ACK, lastAckExchange, receiverId, request.content, std::min<size_t>(request.length, sizeof(uint64_t)));
+    transport->sendTo(&msg, msg.wireSize(), addr);
+    TRACE_INFO(TRACE_ACK_SENT, receiverId, lastAckExchange);
+    acksSent.add();
+}
 
-    std::this_thread::sleep_for(std::chrono::seconds(10));
+void MulticastReceiver::sendNACK()
+{
+    // 直接由重排窗口的位图生成区间列表，超出单个报文的空洞留待下一次NACK
+    Message msg(INIT, 0, 0, "");
+    initNack(msg, NACK, lastReceived + 1, receiverId);
+    int64_t spanStart = -1;
+    int64_t spanEnd = -1;
+    skipWindow.forEachGap([&](int64_t start, int64_t end)
+                          {
+        if (appendNackRange(msg, start, end))
+        {
+            if (spanStart < 0)
+                spanStart = start;
+            spanEnd = end;
+        } });
 
-    receiver.stop();
+    // 已缓存的最大序号之后、发送端已发出的部分，只请求重排窗口能容纳的范围
+    int64_t tailStart = (skipWindow.empty() ? lastReceived : skipWindow.highestSeq()) + 1;
+    int64_t tailEnd = std::min<int64_t>(senderHighest, lastReceived + skipWindow.capacity());
+    if (tailStart <= tailEnd && appendNackRange(msg, tailStart, tailEnd))
+    {
+        if (spanStart < 0)
+            spanStart = tailStart;
+        spanEnd = tailEnd;
+    }
 
-    return 0;
+    transport->sendTo(&msg, msg.wireSize(), addr);
+    TRACE_INFO(TRACE_NACK_SENT, spanStart, spanEnd);
+    nacksSent.add();
+    nackSentUs = Reactor::nowUs();
+    nackRanges.first = spanStart;
+    nackRanges.second = spanEnd;
 }
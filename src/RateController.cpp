@@ -0,0 +1,222 @@
+#include "RateController.h"
+#include "Protocol.h"
+#include <algorithm>
+#include <cmath>
+
+RateController::RateController()
+    : currentRate(0), intervalStart(0), intervalUs(0), intervalBytes(0), limitingReceiver(-1),
+      decreases(0)
+{
+    config.policy = RATE_TRACK_SLOWEST;
+    config.initialRate = 0;
+    config.floorRate = 0;
+    config.maxRate = 0;
+}
+
+void RateController::configure(const RateConfig &newConfig)
+{
+    config = newConfig;
+    currentRate = std::max(config.initialRate, floor());
+    if (config.maxRate > 0)
+    {
+        currentRate = std::min(currentRate, std::max(config.maxRate, floor()));
+    }
+    receivers.clear();
+    intervalUs = 0;
+    limitingReceiver = -1;
+}
+
+double RateController::floor() const
+{
+    return config.policy == RATE_FIXED_FLOOR ? std::max(config.floorRate, RATE_MIN) : RATE_MIN;
+}
+
+RateController::Feedback &RateController::feedback(int nodeId)
+{
+    auto it = receivers.find(nodeId);
+    if (it == receivers.end())
+    {
+        // 新接收方只统计之后发出的报文的丢失，入组后补拉历史的NACK不算作拥塞
+        Feedback fb;
+        fb.ack = 0;
+        fb.lastAck = 0;
+        fb.lastBacklog = 0;
+        fb.nackedUpTo = intervalStart - 1;
+        fb.lost = 0;
+        fb.lossRate = 0;
+        fb.ackRate = 0;
+        fb.rttUs = 0;
+        fb.allowed = 0;
+        fb.acked = false;
+        fb.sampled = false;
+        fb.measured = false;
+        it = receivers.insert(std::make_pair(nodeId, fb)).first;
+    }
+    return it->second;
+}
+
+void RateController::onAck(int nodeId, int64_t ack, uint64_t rttUs)
+{
+    Feedback &fb = feedback(nodeId);
+    fb.ack = fb.acked ? std::max(fb.ack, ack) : ack;
+    fb.acked = true;
+    if (rttUs > 0)
+    {
+        fb.rttUs = fb.rttUs == 0 ? rttUs : fb.rttUs + RATE_EWMA_WEIGHT * (rttUs - fb.rttUs);
+    }
+}
+
+void RateController::onNack(int nodeId, int64_t start, int64_t end)
+{
+    Feedback &fb = feedback(nodeId);
+    int64_t from = std::max(start, fb.nackedUpTo + 1);
+    if (end >= from)
+    {
+        fb.lost += end - from + 1;
+        fb.nackedUpTo = end;
+    }
+}
+
+bool RateController::slowingFor(int nodeId) const
+{
+    if (currentRate <= floor())
+    {
+        return false;
+    }
+    if (nodeId == limitingReceiver)
+    {
+        return true;
+    }
+    auto it = receivers.find(nodeId);
+    return it == receivers.end() || !it->second.measured;
+}
+
+void RateController::erase(int nodeId)
+{
+    receivers.erase(nodeId);
+    if (limitingReceiver == nodeId)
+    {
+        limitingReceiver = -1;
+    }
+}
+
+double RateController::update(uint64_t nowUs, int64_t sendPointer, uint64_t bytesSent, uint64_t packetsSent,
+                              int backlogLimit)
+{
+    if (intervalUs == 0 || nowUs <= intervalUs)
+    {
+        // 第一次调用只建立统计起点
+        intervalStart = sendPointer;
+        intervalUs = nowUs;
+        intervalBytes = bytesSent;
+        return currentRate;
+    }
+
+    double elapsed = (nowUs - intervalUs) / 1e6;
+    int64_t sent = sendPointer - intervalStart;
+    double packetBytes = packetsSent > 0 ? static_cast<double>(bytesSent) / packetsSent : MAX_DATAGRAM_SIZE;
+    double achieved = (bytesSent - intervalBytes) / elapsed;
+
+    limits.clear();
+    for (auto &entry : receivers)
+    {
+        Feedback &fb = entry.second;
+        if (sent > 0)
+        {
+            double loss = std::min(1.0, static_cast<double>(fb.lost) / sent);
+            fb.lossRate += RATE_EWMA_WEIGHT * (loss - fb.lossRate);
+            fb.lost = 0;
+        }
+
+        fb.allowed = 0;
+        if (fb.lossRate > 1e-4)
+        {
+            double rtt = (fb.rttUs > 0 ? fb.rttUs : RATE_DEFAULT_RTT_US) / 1e6;
+            fb.allowed = packetBytes / (rtt * std::sqrt(2 * fb.lossRate / 3));
+        }
+
+        if (!fb.acked)
+        {
+            continue;
+        }
+        int64_t backlog = sendPointer - 1 - fb.ack;
+        if (fb.sampled)
+        {
+            double progress = std::max<int64_t>(0, fb.ack - fb.lastAck) / elapsed;
+            fb.ackRate = fb.ackRate == 0 ? progress : fb.ackRate + RATE_EWMA_WEIGHT * (progress - fb.ackRate);
+            fb.measured = true;
+            if (backlog > backlogLimit && backlog > fb.lastBacklog)
+            {
+                // 积压仍在增长，接收方的消费速率即其可承受的速率
+                double consumed = std::max(fb.ackRate * packetBytes, 1.0);
+                fb.allowed = fb.allowed > 0 ? std::min(fb.allowed, consumed) : consumed;
+            }
+        }
+        fb.lastAck = fb.ack;
+        fb.lastBacklog = backlog;
+        fb.sampled = true;
+    }
+    for (const auto &entry : receivers)
+    {
+        if (entry.second.allowed > 0)
+        {
+            limits.push_back(std::make_pair(entry.second.allowed, entry.first));
+        }
+    }
+
+    // 不受限的接收方视为可承受任意速率，排在最后；P90 跳过最慢的10%
+    size_t skip = 0;
+    if (config.policy == RATE_TRACK_P90)
+    {
+        skip = receivers.size() - static_cast<size_t>(std::ceil(receivers.size() * 0.9));
+    }
+    double target = 0;
+    limitingReceiver = -1;
+    if (skip < limits.size())
+    {
+        std::nth_element(limits.begin(), limits.begin() + skip, limits.end());
+        target = limits[skip].first;
+        limitingReceiver = limits[skip].second;
+    }
+
+    if (target > 0 && target < currentRate)
+    {
+        currentRate = std::max(target, currentRate * RATE_DECREASE);
+        decreases++;
+    }
+    else if (achieved >= currentRate * 0.5)
+    {
+        // 只在实际用到当前速率时增长，避免应用空闲期间速率无限上升
+        double next = currentRate * (1 + RATE_INCREASE);
+        currentRate = target > 0 ? std::min(next, target) : next;
+    }
+    currentRate = std::max(currentRate, floor());
+    if (config.maxRate > 0)
+    {
+        currentRate = std::min(currentRate, std::max(config.maxRate, floor()));
+    }
+
+    intervalStart = sendPointer;
+    intervalUs = nowUs;
+    intervalBytes = bytesSent;
+    return currentRate;
+}
+
+RateControlStats RateController::stats() const
+{
+    RateControlStats result;
+    result.rate = currentRate;
+    result.limitingReceiver = limitingReceiver;
+    result.limitingRate = 0;
+    result.limitingLoss = 0;
+    result.limitingRttUs = 0;
+    result.decreases = decreases;
+    auto it = receivers.find(limitingReceiver);
+    if (it != receivers.end())
+    {
+        result.limitingRate = it->second.allowed;
+        result.limitingLoss = it->second.lossRate;
+        result.limitingRttUs = it->second.rttUs;
+    }
+    return result;
+}
@@ -0,0 +1,183 @@
+#include "Reactor.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <future>
+
+Reactor::Reactor() : timers(nowMs()), looping(false)
+{
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd < 0 || wakeFd < 0)
+    {
+        perror("reactor creation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    // 唤醒事件清空计数后执行投递的任务
+    addFd(wakeFd, EPOLLIN, [this](uint32_t)
+          {
+        uint64_t value;
+        ssize_t n = read(wakeFd, &value, sizeof(value));
+        (void)n;
+        runTasks(); });
+}
+
+Reactor::~Reactor()
+{
+    close(wakeFd);
+    close(epollFd);
+}
+
+bool Reactor::addFd(int fd, uint32_t events, Handler handler)
+{
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        return false;
+    }
+    handlers[fd] = std::move(handler);
+    return true;
+}
+
+void Reactor::removeFd(int fd)
+{
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    handlers.erase(fd);
+}
+
+TimerWheel::TimerId Reactor::runAfter(uint64_t delayMs, std::function<void()> callback)
+{
+    // 先推进到当前时刻，保证延时从现在开始计算
+    timers.advance(nowMs());
+    return timers.schedule(delayMs, std::move(callback));
+}
+
+bool Reactor::cancelTimer(TimerWheel::TimerId id)
+{
+    return timers.cancel(id);
+}
+
+void Reactor::wakeup()
+{
+    uint64_t one = 1;
+    ssize_t n = write(wakeFd, &one, sizeof(one));
+    (void)n;
+}
+
+void Reactor::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        tasks.push_back(std::move(task));
+    }
+    wakeup();
+}
+
+void Reactor::invoke(std::function<void()> task)
+{
+    std::promise<void> done;
+    std::future<void> finished = done.get_future();
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        if (looping && std::this_thread::get_id() != loopThread)
+        {
+            tasks.push_back([&task, &done]()
+                            {
+                task();
+                done.set_value(); });
+            queued = true;
+        }
+    }
+
+    if (!queued)
+    {
+        task();
+        return;
+    }
+    wakeup();
+    finished.wait();
+}
+
+void Reactor::runTasks()
+{
+    std::vector<std::function<void()>> pending;
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        pending.swap(tasks);
+    }
+    for (auto &task : pending)
+    {
+        task();
+    }
+}
+
+void Reactor::runOnce()
+{
+    struct epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(epollFd, events, MAX_EVENTS, timers.nextTimeout());
+    if (n < 0 && errno != EINTR)
+    {
+        perror("epoll_wait failed");
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        // 处理过程中描述符可能已被移除
+        auto it = handlers.find(events[i].data.fd);
+        if (it != handlers.end())
+        {
+            Handler handler = it->second;
+            handler(events[i].events);
+        }
+    }
+
+    timers.advance(nowMs());
+}
+
+void Reactor::run(const std::atomic<bool> &running)
+{
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        looping = true;
+        loopThread = std::this_thread::get_id();
+    }
+
+    runTasks();
+    while (running)
+    {
+        runOnce();
+    }
+
+    // 退出前执行剩余任务，之后的 invoke 直接在调用线程执行
+    std::vector<std::function<void()>> pending;
+    {
+        std::lock_guard<std::mutex> lock(taskMutex);
+        looping = false;
+        pending.swap(tasks);
+    }
+    for (auto &task : pending)
+    {
+        task();
+    }
+}
+
+uint64_t Reactor::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+uint64_t Reactor::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
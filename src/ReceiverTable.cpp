@@ -0,0 +1,216 @@
+#include "ReceiverTable.h"
+#include <utility>
+
+static const size_t INITIAL_SLOTS = 16;
+
+ReceiverNode::ReceiverNode(int64_t ack, int id, uint64_t nowMs) : ackSequenceNumber(ack), nodeId(id), activeMs(nowMs) {}
+
+bool ReceiverNode::operator==(const ReceiverNode &other) const
+{
+    return nodeId == other.nodeId;
+}
+
+ReceiverTable::ReceiverTable()
+{
+    Slot empty = {0, EMPTY};
+    slots.assign(INITIAL_SLOTS, empty);
+}
+
+size_t ReceiverTable::bucketOf(int nodeId) const
+{
+    // nodeId 通常是连续的小整数，乘法散列打散到各个槽位
+    uint32_t hash = static_cast<uint32_t>(nodeId) * 2654435761u;
+    return (hash ^ (hash >> 16)) & (slots.size() - 1);
+}
+
+size_t ReceiverTable::probe(int nodeId) const
+{
+    size_t mask = slots.size() - 1;
+    size_t slot = bucketOf(nodeId);
+    while (slots[slot].heapIndex != EMPTY && slots[slot].nodeId != nodeId)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+const ReceiverNode *ReceiverTable::find(int nodeId) const
+{
+    size_t slot = probe(nodeId);
+    return slots[slot].heapIndex == EMPTY ? nullptr : &heap[slots[slot].heapIndex];
+}
+
+const ReceiverNode *ReceiverTable::minAtLeast(int64_t ack) const
+{
+    // 堆中子节点的ack不小于父节点，满足条件的节点即为其子树中的最小者，只需继续展开不满足条件的节点
+    if (heap.empty() || heap[0].ackSequenceNumber >= ack)
+    {
+        return min();
+    }
+    const ReceiverNode *best = nullptr;
+    std::vector<size_t> pending(1, 0);
+    while (!pending.empty())
+    {
+        size_t index = pending.back();
+        pending.pop_back();
+        const ReceiverNode &node = heap[index];
+        if (node.ackSequenceNumber >= ack)
+        {
+            if (best == nullptr || node.ackSequenceNumber < best->ackSequenceNumber)
+            {
+                best = &node;
+            }
+            continue;
+        }
+        for (size_t child = index * 2 + 1; child <= index * 2 + 2 && child < heap.size(); ++child)
+        {
+            pending.push_back(child);
+        }
+    }
+    return best;
+}
+
+void ReceiverTable::update(int nodeId, int64_t ack, uint64_t nowMs)
+{
+    size_t slot = probe(nodeId);
+    if (slots[slot].heapIndex != EMPTY)
+    {
+        size_t index = slots[slot].heapIndex;
+        if (heap[index].ackSequenceNumber < ack)
+        {
+            // ack只增不减，只需下沉
+            heap[index].ackSequenceNumber = ack;
+            heap[index].activeMs = nowMs;
+            siftDown(index);
+        }
+        return;
+    }
+
+    if ((heap.size() + 1) * 2 > slots.size())
+    {
+        grow();
+        slot = probe(nodeId);
+    }
+
+    slots[slot].nodeId = nodeId;
+    slots[slot].heapIndex = static_cast<int>(heap.size());
+    heap.push_back(ReceiverNode(ack, nodeId, nowMs));
+    slotOf.push_back(slot);
+    siftUp(heap.size() - 1);
+}
+
+void ReceiverTable::touch(int nodeId, uint64_t nowMs)
+{
+    size_t slot = probe(nodeId);
+    if (slots[slot].heapIndex != EMPTY)
+    {
+        heap[slots[slot].heapIndex].activeMs = nowMs;
+    }
+}
+
+bool ReceiverTable::erase(int nodeId)
+{
+    size_t slot = probe(nodeId);
+    if (slots[slot].heapIndex == EMPTY)
+    {
+        return false;
+    }
+
+    // 与堆尾交换后弹出，再按新值上浮或下沉
+    size_t index = slots[slot].heapIndex;
+    size_t last = heap.size() - 1;
+    swapNodes(index, last);
+    heap.pop_back();
+    slotOf.pop_back();
+    removeSlot(slot);
+    if (index < heap.size())
+    {
+        siftUp(index);
+        siftDown(index);
+    }
+    return true;
+}
+
+void ReceiverTable::grow()
+{
+    std::vector<Slot> old;
+    old.swap(slots);
+    Slot empty = {0, EMPTY};
+    slots.assign(old.size() * 2, empty);
+    for (const Slot &entry : old)
+    {
+        if (entry.heapIndex != EMPTY)
+        {
+            size_t slot = probe(entry.nodeId);
+            slots[slot] = entry;
+            slotOf[entry.heapIndex] = slot;
+        }
+    }
+}
+
+void ReceiverTable::removeSlot(size_t slot)
+{
+    size_t mask = slots.size() - 1;
+    size_t hole = slot;
+    size_t next = (hole + 1) & mask;
+    while (slots[next].heapIndex != EMPTY)
+    {
+        // 元素的理想位置不在 (hole, next] 之间时可以前移到空位
+        size_t ideal = bucketOf(slots[next].nodeId);
+        if (((next - ideal) & mask) >= ((next - hole) & mask))
+        {
+            slots[hole] = slots[next];
+            slotOf[slots[hole].heapIndex] = hole;
+            hole = next;
+        }
+        next = (next + 1) & mask;
+    }
+    slots[hole].heapIndex = EMPTY;
+}
+
+void ReceiverTable::swapNodes(size_t a, size_t b)
+{
+    std::swap(heap[a], heap[b]);
+    std::swap(slotOf[a], slotOf[b]);
+    slots[slotOf[a]].heapIndex = static_cast<int>(a);
+    slots[slotOf[b]].heapIndex = static_cast<int>(b);
+}
+
+void ReceiverTable::siftUp(size_t index)
+{
+    while (index > 0)
+    {
+        size_t parent = (index - 1) / 2;
+        if (heap[parent].ackSequenceNumber <= heap[index].ackSequenceNumber)
+        {
+            break;
+        }
+        swapNodes(index, parent);
+        index = parent;
+    }
+}
+
+void ReceiverTable::siftDown(size_t index)
+{
+    size_t count = heap.size();
+    while (true)
+    {
+        size_t smallest = index;
+        size_t left = index * 2 + 1;
+        size_t right = left + 1;
+        if (left < count && heap[left].ackSequenceNumber < heap[smallest].ackSequenceNumber)
+        {
+            smallest = left;
+        }
+        if (right < count && heap[right].ackSequenceNumber < heap[smallest].ackSequenceNumber)
+        {
+            smallest = right;
+        }
+        if (smallest == index)
+        {
+            break;
+        }
+        swapNodes(index, smallest);
+        index = smallest;
+    }
+}
@@ -0,0 +1,200 @@
+#include "SendLog.h"
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <cinttypes>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+SendLog::SendLog()
+    : segmentBytes(SEND_LOG_SEGMENT_SIZE), maxSegments(SEND_LOG_MAX_SEGMENTS), rollMs(0), nextSeq(0), createdCount(0)
+{
+}
+
+SendLog::~SendLog()
+{
+    close();
+}
+
+bool SendLog::open(const std::string &dir, size_t bytes, int segments, int roll)
+{
+    if (isOpen() || dir.empty())
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (stat(dir.c_str(), &st) < 0 && mkdir(dir.c_str(), 0755) < 0)
+    {
+        perror("send log directory creation failed");
+        return false;
+    }
+
+    directory = dir;
+    // 至少能放下一个最大报文
+    segmentBytes = std::max(bytes, sizeof(Message));
+    maxSegments = std::max(segments, 1);
+    rollMs = std::max(roll, 0);
+    nextSeq = 0;
+    return true;
+}
+
+void SendLog::close()
+{
+    while (!segments.empty())
+    {
+        retire();
+    }
+    for (Segment &segment : retired)
+    {
+        destroy(segment);
+    }
+    retired.clear();
+    if (spare.base != nullptr)
+    {
+        destroy(spare);
+        spare = Segment();
+    }
+    directory.clear();
+}
+
+void SendLog::prepare()
+{
+    for (Segment &segment : retired)
+    {
+        destroy(segment);
+    }
+    retired.clear();
+    if (isOpen() && spare.base == nullptr && !createSegment(spare, true))
+    {
+        spare = Segment();
+    }
+}
+
+bool SendLog::append(int64_t seq, const Message &msg, uint64_t nowMs)
+{
+    if (!isOpen())
+    {
+        return false;
+    }
+    if (!segments.empty() && seq != nextSeq)
+    {
+        // 序号不连续，之前的内容无法按序号定位
+        while (!segments.empty())
+        {
+            retire();
+        }
+    }
+
+    size_t size = msg.wireSize();
+    size_t aligned = (size + 7) & ~static_cast<size_t>(7);
+    if (segments.empty() || segments.back().used + aligned > segmentBytes ||
+        (rollMs > 0 && nowMs - segments.back().openedMs >= static_cast<uint64_t>(rollMs)))
+    {
+        if (!roll(seq, nowMs))
+        {
+            return false;
+        }
+    }
+
+    Segment &segment = segments.back();
+    Message *copy = reinterpret_cast<Message *>(segment.base + segment.used);
+    memcpy(copy, &msg, size);
+    copy->type = REPAIR;
+    segment.offsets.push_back(static_cast<uint32_t>(segment.used));
+    segment.used += aligned;
+    nextSeq = seq + 1;
+    return true;
+}
+
+const Message *SendLog::find(int64_t seq) const
+{
+    if (segments.empty() || seq < begin() || seq >= nextSeq)
+    {
+        return nullptr;
+    }
+
+    // 段数很少，从新到旧查找
+    for (auto it = segments.rbegin(); it != segments.rend(); ++it)
+    {
+        if (seq >= it->firstSeq)
+        {
+            return reinterpret_cast<const Message *>(it->base + it->offsets[seq - it->firstSeq]);
+        }
+    }
+    return nullptr;
+}
+
+bool SendLog::roll(int64_t firstSeq, uint64_t nowMs)
+{
+    if (static_cast<int>(segments.size()) >= maxSegments)
+    {
+        retire();
+    }
+
+    Segment segment;
+    if (spare.base != nullptr)
+    {
+        segment = std::move(spare);
+        spare = Segment();
+    }
+    else if (!createSegment(segment, false))
+    {
+        return false;
+    }
+    segment.firstSeq = firstSeq;
+    segment.openedMs = nowMs;
+    segments.push_back(std::move(segment));
+    return true;
+}
+
+bool SendLog::createSegment(Segment &segment, bool populate)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "/%020" PRIu64 ".log", createdCount++);
+    segment.path = directory + name;
+
+    segment.fd = ::open(segment.path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (segment.fd < 0)
+    {
+        perror("send log segment open failed");
+        return false;
+    }
+    // 预先分配磁盘空间，避免写入映射页时因空间不足收到SIGBUS
+    // posix_fallocate 直接返回错误码，不设置errno
+    int rc = posix_fallocate(segment.fd, 0, segmentBytes);
+    if (rc != 0)
+    {
+        fprintf(stderr, "send log segment allocation failed: %s\n", strerror(rc));
+        ::close(segment.fd);
+        unlink(segment.path.c_str());
+        return false;
+    }
+    // 预备段预先建立页表映射，之后追加时不再在调用方的锁内触发缺页
+    void *base = mmap(nullptr, segmentBytes, PROT_READ | PROT_WRITE, MAP_SHARED | (populate ? MAP_POPULATE : 0),
+                      segment.fd, 0);
+    if (base == MAP_FAILED)
+    {
+        perror("send log segment mmap failed");
+        ::close(segment.fd);
+        unlink(segment.path.c_str());
+        return false;
+    }
+    segment.base = static_cast<char *>(base);
+    return true;
+}
+
+void SendLog::retire()
+{
+    retired.push_back(std::move(segments.front()));
+    segments.pop_front();
+}
+
+void SendLog::destroy(Segment &segment)
+{
+    munmap(segment.base, segmentBytes);
+    ::close(segment.fd);
+    unlink(segment.path.c_str());
+}
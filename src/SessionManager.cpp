@@ -0,0 +1,82 @@
+#include "SessionManager.h"
+#include <algorithm>
+
+SessionManager::SessionManager(int threadCount) : running(false)
+{
+    if (threadCount <= 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threadCount; ++i)
+    {
+        workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    }
+}
+
+SessionManager::~SessionManager()
+{
+    stop();
+}
+
+void SessionManager::start()
+{
+    if (running.exchange(true))
+    {
+        return;
+    }
+    for (auto &worker : workers)
+    {
+        Worker *w = worker.get();
+        w->thread = std::thread([this, w]()
+                                { w->reactor.run(running); });
+    }
+}
+
+void SessionManager::stop()
+{
+    running = false;
+    for (auto &worker : workers)
+    {
+        worker->reactor.wakeup();
+        if (worker->thread.joinable())
+        {
+            worker->thread.join();
+        }
+    }
+}
+
+Reactor *SessionManager::acquire()
+{
+    Worker *best = workers.front().get();
+    for (auto &worker : workers)
+    {
+        if (worker->sessions.load() < best->sessions.load())
+        {
+            best = worker.get();
+        }
+    }
+    best->sessions++;
+    return &best->reactor;
+}
+
+void SessionManager::release(Reactor *reactor)
+{
+    for (auto &worker : workers)
+    {
+        if (&worker->reactor == reactor)
+        {
+            worker->sessions--;
+            return;
+        }
+    }
+}
+
+std::vector<int> SessionManager::sessionCounts() const
+{
+    std::vector<int> counts;
+    for (auto &worker : workers)
+    {
+        counts.push_back(worker->sessions.load());
+    }
+    return counts;
+}
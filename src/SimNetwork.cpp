@@ -0,0 +1,317 @@
+#include "SimNetwork.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <cerrno>
+#include <algorithm>
+#include <arpa/inet.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+static uint64_t nowNs()
+{
+    // 与 timerfd 的 CLOCK_MONOTONIC 同源
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static bool sameAddress(const struct sockaddr_in &a, const struct sockaddr_in &b)
+{
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+SimConfig::SimConfig()
+    : lossRate(0), burstStart(0), burstEnd(1), reorderRate(0), reorderDelayUs(0), duplicateRate(0), delayUs(0),
+      jitterUs(0), linkBytesPerSec(0), queueBytes(64 * 1024), seed(1)
+{
+}
+
+SimNetwork::SimNetwork(const SimConfig &config)
+    : config(config), rng(config.seed), uniform(0.0, 1.0), nextAddress(1), nextOrder(0)
+{
+    memset(&counters, 0, sizeof(counters));
+}
+
+SimNetwork::~SimNetwork()
+{
+}
+
+Transport *SimNetwork::createTransport(const std::string &multicastAddress, int port, bool joinGroup)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    struct sockaddr_in group;
+    memset(&group, 0, sizeof(group));
+    group.sin_family = AF_INET;
+    group.sin_addr.s_addr = inet_addr(multicastAddress.c_str());
+    group.sin_port = htons(port);
+
+    // 每个端点分配 10.x.x.x 中唯一的单播地址
+    struct sockaddr_in local;
+    memset(&local, 0, sizeof(local));
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl((10u << 24) | nextAddress++);
+    local.sin_port = htons(port);
+
+    SimTransport *endpoint = new SimTransport(this, group, local, joinGroup);
+    endpoints.push_back(endpoint);
+    return endpoint;
+}
+
+void SimNetwork::setConfig(const SimConfig &newConfig)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    config = newConfig;
+}
+
+void SimNetwork::setLinkRate(Transport *endpoint, double bytesPerSec)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    static_cast<SimTransport *>(endpoint)->linkRate = bytesPerSec;
+}
+
+SimStats SimNetwork::stats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+void SimNetwork::detach(SimTransport *endpoint)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    endpoints.erase(std::remove(endpoints.begin(), endpoints.end(), endpoint), endpoints.end());
+}
+
+ssize_t SimNetwork::send(SimTransport *source, const void *data, size_t length, const struct sockaddr_in &to)
+{
+    counters.sent++;
+    uint64_t now = nowNs();
+    for (SimTransport *endpoint : endpoints)
+    {
+        if (endpoint == source)
+        {
+            continue;
+        }
+        // 组播投递给加入同一组的端点，单播投递给地址相同的端点；没有目的端点时静默丢弃
+        bool multicast = endpoint->joined && sameAddress(endpoint->group, to);
+        if (multicast || sameAddress(endpoint->local, to))
+        {
+            deliver(endpoint, source->local, data, length, now);
+        }
+    }
+    return static_cast<ssize_t>(length);
+}
+
+void SimNetwork::deliver(SimTransport *target, const struct sockaddr_in &from, const void *data, size_t length,
+                         uint64_t now)
+{
+    // 两状态突发丢包模型，状态按目的端点分别维护
+    if (target->inBurst)
+    {
+        if (uniform(rng) < config.burstEnd)
+        {
+            target->inBurst = false;
+        }
+        counters.dropped++;
+        return;
+    }
+    if (config.burstStart > 0 && uniform(rng) < config.burstStart)
+    {
+        target->inBurst = true;
+        counters.dropped++;
+        return;
+    }
+    if (config.lossRate > 0 && uniform(rng) < config.lossRate)
+    {
+        counters.dropped++;
+        return;
+    }
+
+    // 入口链路按带宽逐个发送，排队超过队列容量时尾部丢弃
+    uint64_t departAt = now;
+    double rate = target->linkRate >= 0 ? target->linkRate : config.linkBytesPerSec;
+    if (rate > 0)
+    {
+        uint64_t start = std::max(now, target->linkFreeAt);
+        if ((start - now) / 1e9 * rate > config.queueBytes)
+        {
+            counters.dropped++;
+            counters.queueDropped++;
+            return;
+        }
+        target->linkFreeAt = start + static_cast<uint64_t>(length / rate * 1e9);
+        departAt = target->linkFreeAt;
+    }
+
+    int copies = 1;
+    if (config.duplicateRate > 0 && uniform(rng) < config.duplicateRate)
+    {
+        copies = 2;
+        counters.duplicated++;
+    }
+
+    for (int i = 0; i < copies; ++i)
+    {
+        Packet packet;
+        packet.deliverAt = departAt + delay();
+        if (config.reorderRate > 0 && uniform(rng) < config.reorderRate)
+        {
+            packet.deliverAt += static_cast<uint64_t>(config.reorderDelayUs) * 1000;
+            counters.reordered++;
+        }
+        packet.order = nextOrder++;
+        packet.from = from;
+        packet.data.assign(static_cast<const char *>(data), length);
+        if (target->armedAt == 0 || packet.deliverAt < target->armedAt)
+        {
+            target->inbox.push(std::move(packet));
+            target->rearm();
+        }
+        else
+        {
+            target->inbox.push(std::move(packet));
+        }
+        counters.delivered++;
+    }
+}
+
+uint64_t SimNetwork::delay()
+{
+    uint64_t us = static_cast<uint64_t>(std::max(0, config.delayUs));
+    if (config.jitterUs > 0)
+    {
+        us += static_cast<uint64_t>(uniform(rng) * config.jitterUs);
+    }
+    return us * 1000;
+}
+
+SimTransport::SimTransport(SimNetwork *network, const struct sockaddr_in &group, const struct sockaddr_in &local,
+                           bool joined)
+    : network(network), group(group), local(local), joined(joined), armedAt(0), inBurst(false),
+      linkRate(-1), linkFreeAt(0)
+{
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (timerFd < 0)
+    {
+        perror("timerfd creation failed");
+        exit(EXIT_FAILURE);
+    }
+}
+
+SimTransport::~SimTransport()
+{
+    network->detach(this);
+    close(timerFd);
+}
+
+int SimTransport::sendBatch(struct mmsghdr *msgs, int count)
+{
+    std::lock_guard<std::mutex> lock(network->mutex);
+    std::string gathered;
+    for (int i = 0; i < count; ++i)
+    {
+        const struct msghdr &hdr = msgs[i].msg_hdr;
+        const struct sockaddr_in &to = *static_cast<const struct sockaddr_in *>(hdr.msg_name);
+        if (hdr.msg_iovlen == 1)
+        {
+            network->send(this, hdr.msg_iov[0].iov_base, hdr.msg_iov[0].iov_len, to);
+            msgs[i].msg_len = hdr.msg_iov[0].iov_len;
+            continue;
+        }
+        gathered.clear();
+        for (size_t j = 0; j < hdr.msg_iovlen; ++j)
+        {
+            gathered.append(static_cast<const char *>(hdr.msg_iov[j].iov_base), hdr.msg_iov[j].iov_len);
+        }
+        network->send(this, gathered.data(), gathered.size(), to);
+        msgs[i].msg_len = gathered.size();
+    }
+    return count;
+}
+
+int SimTransport::recvBatch(struct mmsghdr *msgs, int count)
+{
+    std::lock_guard<std::mutex> lock(network->mutex);
+    uint64_t expirations;
+    ssize_t r = read(timerFd, &expirations, sizeof(expirations));
+    (void)r;
+
+    uint64_t now = nowNs();
+    int n = 0;
+    while (n < count)
+    {
+        struct msghdr &hdr = msgs[n].msg_hdr;
+        size_t length;
+        if (!popDue(hdr.msg_iov[0].iov_base, hdr.msg_iov[0].iov_len, &length,
+                    static_cast<struct sockaddr_in *>(hdr.msg_name), now))
+        {
+            break;
+        }
+        hdr.msg_namelen = sizeof(struct sockaddr_in);
+        msgs[n].msg_len = static_cast<unsigned int>(length);
+        n++;
+    }
+    rearm();
+    return n;
+}
+
+ssize_t SimTransport::sendTo(const void *data, size_t length, const struct sockaddr_in &to)
+{
+    std::lock_guard<std::mutex> lock(network->mutex);
+    return network->send(this, data, length, to);
+}
+
+ssize_t SimTransport::recvFrom(void *buffer, size_t length, struct sockaddr_in *from)
+{
+    std::lock_guard<std::mutex> lock(network->mutex);
+    uint64_t expirations;
+    ssize_t r = read(timerFd, &expirations, sizeof(expirations));
+    (void)r;
+
+    size_t received;
+    bool got = popDue(buffer, length, &received, from, nowNs());
+    rearm();
+    if (!got)
+    {
+        errno = EAGAIN;
+        return -1;
+    }
+    return static_cast<ssize_t>(received);
+}
+
+bool SimTransport::popDue(void *buffer, size_t capacity, size_t *length, struct sockaddr_in *from, uint64_t now)
+{
+    if (inbox.empty() || inbox.top().deliverAt > now)
+    {
+        return false;
+    }
+    const SimNetwork::Packet &packet = inbox.top();
+    // 与UDP一致，超出缓冲的部分被截断
+    *length = std::min(capacity, packet.data.size());
+    memcpy(buffer, packet.data.data(), *length);
+    if (from)
+    {
+        *from = packet.from;
+    }
+    inbox.pop();
+    return true;
+}
+
+void SimTransport::rearm()
+{
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (inbox.empty())
+    {
+        armedAt = 0;
+    }
+    else
+    {
+        // 绝对时间已过去时立即到期，0 表示取消，因此至少为1纳秒
+        armedAt = std::max<uint64_t>(inbox.top().deliverAt, 1);
+        spec.it_value.tv_sec = armedAt / 1000000000;
+        spec.it_value.tv_nsec = armedAt % 1000000000;
+    }
+    timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, nullptr);
+}
@@ -0,0 +1,56 @@
+#include "Stats.h"
+
+void Histogram::record(uint64_t value)
+{
+    int bucket = value == 0 ? 0 : 64 - __builtin_clzll(value);
+    if (bucket >= HISTOGRAM_BUCKETS)
+    {
+        bucket = HISTOGRAM_BUCKETS - 1;
+    }
+    buckets[bucket].add();
+    count.add();
+    sum.add(value);
+    if (value > max.get())
+    {
+        max.set(value);
+    }
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    HistogramSnapshot snap;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+    {
+        snap.buckets[i] = buckets[i].get();
+    }
+    snap.count = count.get();
+    snap.sum = sum.get();
+    snap.max = max.get();
+    return snap;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const
+{
+    // 读取期间仍在写入，按各桶之和而不是 count 计算
+    uint64_t total = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+    {
+        total += buckets[i];
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(p * total);
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+    {
+        seen += buckets[i];
+        if (seen > target)
+        {
+            return i == 0 ? 0 : ((1ULL << i) - 1);
+        }
+    }
+    return max;
+}
@@ -0,0 +1,189 @@
+#include "TimerWheel.h"
+#include <algorithm>
+
+TimerWheel::TimerWheel(uint64_t nowMs) : occupied(), currentTick(nowMs), nextId(1) {}
+
+TimerWheel::TimerId TimerWheel::schedule(uint64_t delayMs, std::function<void()> callback)
+{
+    // 当前槽已处理过，最早在下一个tick到期
+    std::list<Timer> pending;
+    pending.push_back(Timer{nextId++, currentTick + std::max<uint64_t>(delayMs, 1), std::move(callback), 0, 0});
+    auto it = pending.begin();
+    index[it->id] = it;
+    place(pending, it);
+    return it->id;
+}
+
+bool TimerWheel::cancel(TimerId id)
+{
+    auto found = index.find(id);
+    if (found == index.end())
+    {
+        return false;
+    }
+
+    auto it = found->second;
+    if (it->level == FIRING)
+    {
+        firing.erase(it);
+    }
+    else
+    {
+        int level = it->level;
+        int slot = it->slot;
+        std::list<Timer> &bucket = wheel[level][slot];
+        bucket.erase(it);
+        if (level == 0 && bucket.empty())
+        {
+            markSlot(slot, false);
+        }
+    }
+    index.erase(found);
+    return true;
+}
+
+void TimerWheel::advance(uint64_t nowMs)
+{
+    if (index.empty())
+    {
+        // 无定时器时直接跳到当前时刻
+        currentTick = std::max(currentTick, nowMs);
+        return;
+    }
+
+    while (currentTick < nowMs)
+    {
+        // 直接跳到本圈内下一个非空槽或下一次高层下放，取较早者，且不超过 nowMs
+        uint64_t next = (currentTick | (SLOTS - 1)) + 1;
+        int distance = nextOccupied();
+        if (distance > 0)
+        {
+            next = std::min<uint64_t>(next, currentTick + distance);
+        }
+        currentTick = std::min(next, nowMs) - 1;
+        tick();
+    }
+}
+
+int TimerWheel::nextOccupied() const
+{
+    int start = static_cast<int>(currentTick & (SLOTS - 1)) + 1;
+    for (int word = start / 64; word < SLOTS / 64; ++word)
+    {
+        uint64_t bits = occupied[word];
+        if (word == start / 64)
+        {
+            bits &= ~0ULL << (start % 64);
+        }
+        if (bits != 0)
+        {
+            return word * 64 + __builtin_ctzll(bits) - start + 1;
+        }
+    }
+    return 0;
+}
+
+void TimerWheel::markSlot(int slot, bool occupy)
+{
+    if (occupy)
+    {
+        occupied[slot / 64] |= 1ULL << (slot % 64);
+    }
+    else
+    {
+        occupied[slot / 64] &= ~(1ULL << (slot % 64));
+    }
+}
+
+int TimerWheel::nextTimeout() const
+{
+    if (index.empty())
+    {
+        return -1;
+    }
+
+    // 先在第0层向后查找最近的非空槽
+    for (int i = 1; i < SLOTS; ++i)
+    {
+        if (!wheel[0][(currentTick + i) & (SLOTS - 1)].empty())
+        {
+            return i;
+        }
+    }
+
+    // 第0层为空时，等到下一次高层下放
+    return static_cast<int>(SLOTS - (currentTick & (SLOTS - 1)));
+}
+
+// 按剩余时间选择所在层，节点通过splice移动，迭代器保持有效
+void TimerWheel::place(std::list<Timer> &from, std::list<Timer>::iterator it)
+{
+    uint64_t delta = it->expires > currentTick ? it->expires - currentTick : 0;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (1ULL << (SLOT_BITS * (level + 1))))
+    {
+        level++;
+    }
+
+    uint64_t expires = it->expires;
+    if (level == LEVELS - 1 && delta >= (1ULL << (SLOT_BITS * LEVELS)))
+    {
+        // 超出最大范围时挂在最高层最远的槽上，下放后重新计算
+        expires = currentTick + (1ULL << (SLOT_BITS * LEVELS)) - 1;
+    }
+
+    int slot = static_cast<int>((expires >> (SLOT_BITS * level)) & (SLOTS - 1));
+    it->level = level;
+    it->slot = slot;
+    wheel[level][slot].splice(wheel[level][slot].end(), from, it);
+    if (level == 0)
+    {
+        markSlot(slot, true);
+    }
+}
+
+void TimerWheel::cascade(int level, int slot)
+{
+    std::list<Timer> &bucket = wheel[level][slot];
+    while (!bucket.empty())
+    {
+        place(bucket, bucket.begin());
+    }
+}
+
+void TimerWheel::tick()
+{
+    currentTick++;
+    int slot = static_cast<int>(currentTick & (SLOTS - 1));
+
+    // 低层转完一圈时，把上一层对应槽中的定时器下放
+    if (slot == 0)
+    {
+        for (int level = 1; level < LEVELS; ++level)
+        {
+            int upper = static_cast<int>((currentTick >> (SLOT_BITS * level)) & (SLOTS - 1));
+            cascade(level, upper);
+            if (upper != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    std::list<Timer> &bucket = wheel[0][slot];
+    for (auto &timer : bucket)
+    {
+        timer.level = FIRING;
+    }
+    firing.splice(firing.end(), bucket);
+    markSlot(slot, false);
+
+    // 逐个取出执行，回调中取消的定时器已从firing中移除
+    while (!firing.empty())
+    {
+        std::function<void()> callback = std::move(firing.front().callback);
+        index.erase(firing.front().id);
+        firing.pop_front();
+        callback();
+    }
+}
@@ -0,0 +1,123 @@
+#include "TokenBucket.h"
+#include <algorithm>
+#include <chrono>
+
+static const uint64_t STATS_PERIOD_US = 1000000; // 吞吐统计周期
+
+TokenBucket::TokenBucket()
+    : bytesRate(0), packetsRate(0), burstBytes(0), burstPackets(0), byteTokens(0), packetTokens(0),
+      lastRefill(nowUs()), periodStart(lastRefill), periodBytes(0), periodPackets(0), achievedBytes(0),
+      achievedPackets(0)
+{
+}
+
+void TokenBucket::setRate(double bytesPerSec, double packetsPerSec, double burstBytes, double burstPackets)
+{
+    bytesRate = std::max(0.0, bytesPerSec);
+    packetsRate = std::max(0.0, packetsPerSec);
+    this->burstBytes = std::max(burstBytes, 1.0);
+    this->burstPackets = std::max(burstPackets, 1.0);
+
+    // 重新设置速率后从满桶开始
+    byteTokens = this->burstBytes;
+    packetTokens = this->burstPackets;
+    lastRefill = nowUs();
+}
+
+void TokenBucket::adjustRate(double bytesPerSec, double burst, uint64_t now)
+{
+    bool wasLimited = bytesRate > 0;
+    refill(now);
+    bytesRate = std::max(0.0, bytesPerSec);
+    burstBytes = std::max(burst, 1.0);
+    // 之前不限速时桶中没有令牌，从满桶开始
+    byteTokens = wasLimited ? std::min(byteTokens, burstBytes) : burstBytes;
+}
+
+bool TokenBucket::tryConsume(size_t bytes, uint64_t now)
+{
+    if (!unlimited())
+    {
+        refill(now);
+        // 报文大于桶容量时，令牌攒满即可发送，透支部分由之后的令牌补回
+        if ((bytesRate > 0 && byteTokens < std::min<double>(bytes, burstBytes)) ||
+            (packetsRate > 0 && packetTokens < 1))
+        {
+            return false;
+        }
+        byteTokens -= bytes;
+        packetTokens -= 1;
+    }
+    record(bytes, now);
+    return true;
+}
+
+uint64_t TokenBucket::waitTime(size_t bytes, uint64_t now)
+{
+    if (unlimited())
+    {
+        return 0;
+    }
+
+    refill(now);
+    double wait = 0;
+    double needBytes = std::min<double>(bytes, burstBytes);
+    if (bytesRate > 0 && byteTokens < needBytes)
+    {
+        wait = std::max(wait, (needBytes - byteTokens) / bytesRate);
+    }
+    if (packetsRate > 0 && packetTokens < 1)
+    {
+        wait = std::max(wait, (1 - packetTokens) / packetsRate);
+    }
+    return static_cast<uint64_t>(wait * 1e6) + (wait > 0 ? 1 : 0);
+}
+
+PacingStats TokenBucket::stats(uint64_t now)
+{
+    // 超过一个周期没有发送时吞吐视为0
+    record(0, now);
+    PacingStats result;
+    result.bytesRate = bytesRate;
+    result.packetsRate = packetsRate;
+    result.achievedBytes = achievedBytes;
+    result.achievedPackets = achievedPackets;
+    return result;
+}
+
+uint64_t TokenBucket::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void TokenBucket::refill(uint64_t now)
+{
+    if (now <= lastRefill)
+    {
+        return;
+    }
+    double elapsed = (now - lastRefill) / 1e6;
+    byteTokens = std::min(burstBytes, byteTokens + elapsed * bytesRate);
+    packetTokens = std::min(burstPackets, packetTokens + elapsed * packetsRate);
+    lastRefill = now;
+}
+
+void TokenBucket::record(size_t bytes, uint64_t now)
+{
+    if (now - periodStart >= STATS_PERIOD_US)
+    {
+        double elapsed = (now - periodStart) / 1e6;
+        achievedBytes = periodBytes / elapsed;
+        achievedPackets = periodPackets / elapsed;
+        periodStart = now;
+        periodBytes = 0;
+        periodPackets = 0;
+    }
+    if (bytes > 0)
+    {
+        periodBytes += bytes;
+        periodPackets++;
+    }
+}
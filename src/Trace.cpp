@@ -0,0 +1,226 @@
+#include "Trace.h"
+#include "SpscQueue.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+static const int TRACE_FLUSH_INTERVAL_MS = 10; // 落盘线程轮询间隔
+static const int TRACE_WRITE_BATCH = 256;      // 单次从一个缓冲取出的记录数
+
+namespace
+{
+    // 每个线程一个缓冲，线程本身为唯一生产者，落盘线程为唯一消费者
+    struct ThreadBuffer
+    {
+        ThreadBuffer(uint32_t id) : queue(TRACE_BUFFER_SIZE), thread(id), dropped(0), exited(false) {}
+
+        SpscQueue<TraceRecord> queue;
+        uint32_t thread;
+        std::atomic<unsigned long long> dropped;
+        std::atomic<bool> exited; // 所属线程已退出，不会再写入
+    };
+
+    // 线程退出后缓冲仍留在登记表中，剩余记录落盘后才移入空闲表，供之后新建的线程复用
+    std::mutex registryMutex;
+    std::vector<ThreadBuffer *> registry;
+    std::vector<ThreadBuffer *> freeBuffers;
+    uint32_t nextThread = 1;
+    unsigned long long recycledDropped = 0; // 已回收缓冲的丢弃数
+
+    // 线程退出后其他 thread_local 析构函数中的埋点直接丢弃，不再分配缓冲
+    thread_local bool localExited = false;
+
+    // 线程退出时标记其缓冲，由落盘线程写出剩余记录后回收
+    struct BufferOwner
+    {
+        ThreadBuffer *buffer = nullptr;
+
+        ~BufferOwner()
+        {
+            localExited = true;
+            if (buffer != nullptr)
+            {
+                buffer->exited.store(true, std::memory_order_release);
+            }
+        }
+    };
+    thread_local BufferOwner localOwner;
+
+    std::mutex fileMutex;
+    FILE *traceFile = nullptr;
+    std::thread writer;
+    std::atomic<bool> writerRunning(false);
+
+    ThreadBuffer *threadBuffer()
+    {
+        if (localOwner.buffer == nullptr)
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            ThreadBuffer *buffer;
+            if (freeBuffers.empty())
+            {
+                buffer = new ThreadBuffer(nextThread);
+            }
+            else
+            {
+                // 回收的缓冲已写空，换上新的线程序号
+                buffer = freeBuffers.back();
+                freeBuffers.pop_back();
+                buffer->thread = nextThread;
+                buffer->exited.store(false, std::memory_order_relaxed);
+            }
+            nextThread++;
+            registry.push_back(buffer);
+            localOwner.buffer = buffer;
+        }
+        return localOwner.buffer;
+    }
+
+    // 线程已退出且记录已写空的缓冲移入空闲表
+    void recycle(ThreadBuffer *buffer)
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.erase(std::find(registry.begin(), registry.end(), buffer));
+        recycledDropped += buffer->dropped.exchange(0, std::memory_order_relaxed);
+        freeBuffers.push_back(buffer);
+    }
+
+    // 只在落盘线程或其退出后调用，保证单消费者
+    void writeAll()
+    {
+        std::vector<ThreadBuffer *> buffers;
+        {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            buffers = registry;
+        }
+
+        TraceRecord batch[TRACE_WRITE_BATCH];
+        for (ThreadBuffer *buffer : buffers)
+        {
+            // 先读退出标记：线程退出前写入的记录在此之后都能取到
+            bool exited = buffer->exited.load(std::memory_order_acquire);
+            size_t n;
+            while ((n = buffer->queue.pop(batch, TRACE_WRITE_BATCH)) > 0)
+            {
+                fwrite(batch, sizeof(TraceRecord), n, traceFile);
+            }
+            if (exited)
+            {
+                recycle(buffer);
+            }
+        }
+        fflush(traceFile);
+    }
+
+    void writerLoop()
+    {
+        while (writerRunning.load(std::memory_order_relaxed))
+        {
+            writeAll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(TRACE_FLUSH_INTERVAL_MS));
+        }
+    }
+}
+
+std::atomic<bool> Trace::active(false);
+
+bool Trace::open(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (traceFile != nullptr)
+    {
+        return false;
+    }
+
+    traceFile = fopen(path.c_str(), "wb");
+    if (traceFile == nullptr)
+    {
+        perror("trace open failed");
+        return false;
+    }
+
+    TraceFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "MCTRACE", 7);
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    fwrite(&header, sizeof(header), 1, traceFile);
+
+    writerRunning = true;
+    writer = std::thread(writerLoop);
+    active.store(true, std::memory_order_relaxed);
+    return true;
+}
+
+void Trace::close()
+{
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (traceFile == nullptr)
+    {
+        return;
+    }
+
+    active.store(false, std::memory_order_relaxed);
+    writerRunning = false;
+    writer.join();
+    // 落盘线程已退出，由本线程接手写出剩余记录
+    writeAll();
+    fclose(traceFile);
+    traceFile = nullptr;
+}
+
+void Trace::record(TraceEvent event, int level, int64_t arg0, int64_t arg1)
+{
+    if (localExited)
+    {
+        return;
+    }
+    ThreadBuffer *buffer = threadBuffer();
+
+    TraceRecord rec;
+    rec.timestamp = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+            .count());
+    rec.thread = buffer->thread;
+    rec.event = static_cast<uint16_t>(event);
+    rec.level = static_cast<uint8_t>(level);
+    rec.reserved = 0;
+    rec.arg0 = arg0;
+    rec.arg1 = arg1;
+
+    if (!buffer->queue.push(std::move(rec)))
+    {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+unsigned long long Trace::dropped()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    unsigned long long total = recycledDropped;
+    for (ThreadBuffer *buffer : registry)
+    {
+        total += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+const char *Trace::eventName(uint16_t event)
+{
+    static const char *const names[TRACE_EVENT_COUNT] = {
+        "ENQUEUE",       "SEND",          "RETRANSMIT",       "FEC_SEND",      "ACK_REQUEST",
+        "ACK_RECEIVED",  "NACK_RECEIVED", "NACK_OUT_WINDOW",  "RECEIVER_EVICTED",
+        "ACK_SENT",      "NACK_SENT",     "NACK_SUPPRESSED",  "FEC_RECOVERED", "NACK_EXHAUSTED",
+        "JOIN_REQUEST",  "JOINED"};
+    return event < TRACE_EVENT_COUNT ? names[event] : "UNKNOWN";
+}
+
+const char *Trace::levelName(uint8_t level)
+{
+    static const char *const names[] = {"DEBUG", "INFO", "WARN"};
+    return level < TRACE_LEVEL_OFF ? names[level] : "UNKNOWN";
+}
@@ -0,0 +1,92 @@
+#include "UdpTransport.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+UdpTransport::UdpTransport(const std::string &multicastAddress, int port, bool joinGroup)
+{
+    // 按IPv4和UDP协议创建套接字
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0)
+    {
+        perror("socket creation failed");
+        exit(EXIT_FAILURE);
+    }
+
+    memset(&group, 0, sizeof(group));
+    group.sin_family = AF_INET;
+    group.sin_addr.s_addr = inet_addr(multicastAddress.c_str());
+    group.sin_port = htons(port);
+
+    if (joinGroup)
+    {
+        struct sockaddr_in local;
+        memset(&local, 0, sizeof(local));
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(port);
+
+        // 同一进程中可能有多个会话绑定同一端口，且每个套接字只接收自己加入的组
+        int reuse = 1;
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+        int multicastAll = 0;
+        setsockopt(sockfd, IPPROTO_IP, IP_MULTICAST_ALL, &multicastAll, sizeof(multicastAll));
+        // 发送端不限速时一个窗口的报文可能连续到达，默认接收缓冲区容纳不下
+        int rcvbuf = UDP_RECV_BUFFER;
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+        if (bind(sockfd, (const struct sockaddr *)&local, sizeof(local)) < 0)
+        {
+            perror("bind failed");
+            close(sockfd);
+            exit(EXIT_FAILURE);
+        }
+
+        struct ip_mreq mreq;
+        mreq.imr_multiaddr.s_addr = group.sin_addr.s_addr;
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if (setsockopt(sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+        {
+            perror("setsockopt failed");
+            close(sockfd);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // 设置套接字为非阻塞模式
+    int flags = fcntl(sockfd, F_GETFL, 0);
+    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+}
+
+UdpTransport::~UdpTransport()
+{
+    close(sockfd);
+}
+
+int UdpTransport::sendBatch(struct mmsghdr *msgs, int count)
+{
+    return sendmmsg(sockfd, msgs, count, 0);
+}
+
+int UdpTransport::recvBatch(struct mmsghdr *msgs, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    }
+    return recvmmsg(sockfd, msgs, count, MSG_DONTWAIT, nullptr);
+}
+
+ssize_t UdpTransport::sendTo(const void *data, size_t length, const struct sockaddr_in &to)
+{
+    return sendto(sockfd, data, length, 0, (const struct sockaddr *)&to, sizeof(to));
+}
+
+ssize_t UdpTransport::recvFrom(void *buffer, size_t length, struct sockaddr_in *from)
+{
+    socklen_t len = sizeof(*from);
+    return recvfrom(sockfd, buffer, length, 0, (struct sockaddr *)from, &len);
+}
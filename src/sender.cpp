@@ -1,128 +1,443 @@
-#include "MulticastSender.h"
+#include "sender.h"
 
-Message::Message(MessageType type, int seq, const std::string &msg)
-    : type(type), sequenceNumber(seq), nodeId(0)
+MulticastSender::MulticastSender(const std::string &multicastAddress, int port, int windowSize)
+    : MulticastSender(std::unique_ptr<Transport>(new UdpTransport(multicastAddress, port, false)), nullptr, windowSize)
 {
-    strncpy(content, msg.c_str(), sizeof(content));
 }
 
-ReceiverNode::ReceiverNode(int ack, int id) : ackSequenceNumber(ack), nodeId(id) {}
+MulticastSender::MulticastSender(const std::string &multicastAddress, int port, SessionManager &manager,
+                                 int windowSize)
+    : MulticastSender(std::unique_ptr<Transport>(new UdpTransport(multicastAddress, port, false)), &manager,
+                      windowSize)
+{
+}
+
+MulticastSender::MulticastSender(std::unique_ptr<Transport> transport, int windowSize)
+    : MulticastSender(std::move(transport), nullptr, windowSize)
+{
+}
 
-bool ReceiverNode::operator==(const ReceiverNode &other) const
+MulticastSender::MulticastSender(std::unique_ptr<Transport> transport, SessionManager &manager, int windowSize)
+    : MulticastSender(std::move(transport), &manager, windowSize)
 {
-    return nodeId == other.nodeId;
 }
 
-MulticastSender::MulticastSender(const std::string &multicastAddress, int port)
-    : multicastAddress(multicastAddress), port(port), sequenceNumber(0), lastAckExchange(0), callback(nullptr), running(false)
+MulticastSender::MulticastSender(std::unique_ptr<Transport> transport, SessionManager *manager, int windowSize)
+    : transport(std::move(transport)), sequenceNumber(0), lastAckExchange(0), sendPointer(0),
+      maxPayload(MAX_PAYLOAD_SIZE), reserved(false), coalesceBytes(0), coalesceHoldUs(0), messageNumber(0),
+      coalesceOpen(false), coalesceOpenedUs(0), sendQueue(windowSize, Message(INIT, 0, 0, "")), callback(nullptr),
+      batchSize(SEND_BATCH_SIZE), batchFill(0), sendBlocked(false), batchCount(0), syscallCount(0), datagramCount(0),
+      manager(manager), reactor(nullptr), flushPending(false), ackTimer(0), flushTimer(0), lastAckRequest(0),
+      rateControlled(false),
+      fecBlockSize(0), fecBlockStart(0), fecBlockFill(0), fecMaxLength(0), fecReady(false),
+      fecParity(INIT, 0, 0, ""), fecTimer(0), running(false)
 {
-    // 按IPv4和UDP协议创建套接字
-    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-    if (sockfd < 0)
+    repairStamps.assign(sendQueue.capacity(), std::make_pair(-1, 0));
+    limitingGauge.set(static_cast<uint64_t>(static_cast<int64_t>(-1)));
+    addr = this->transport->groupAddress();
+
+    // 批量发送的目的地址固定为组播地址，预先填好
+    memset(batchHdrs, 0, sizeof(batchHdrs));
+    for (int i = 0; i < MAX_SEND_BATCH; ++i)
     {
-        perror("socket creation failed");
-        exit(EXIT_FAILURE);
+        batchHdrs[i].msg_hdr.msg_name = &addr;
+        batchHdrs[i].msg_hdr.msg_namelen = sizeof(addr);
+        batchHdrs[i].msg_hdr.msg_iov = &batchIovs[i];
+        batchHdrs[i].msg_hdr.msg_iovlen = 1;
     }
 
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = inet_addr(multicastAddress.c_str());
-    addr.sin_port = htons(port);
-
-    // 设置套接字为非阻塞模式
-    int flags = fcntl(sockfd, F_GETFL, 0);
-    fcntl(sockfd, F_SETFL, flags | O_NONBLOCK);
+    // 应用线程入队后通过eventfd通知事件循环发送
+    flushFd = eventfd(0, EFD_NONBLOCK);
+    if (flushFd < 0)
+    {
+        perror("eventfd failed");
+        exit(EXIT_FAILURE);
+    }
 
-    // 初始化定时器和发送断点
-    lastAckTime = std::chrono::steady_clock::now();
-    sendPointer = sendQueue.begin();
+    if (manager)
+    {
+        reactor = manager->acquire();
+    }
+    else
+    {
+        ownedReactor.reset(new Reactor());
+        reactor = ownedReactor.get();
+    }
 }
 
 MulticastSender::~MulticastSender()
 {
     stop();
-    close(sockfd);
+    if (manager)
+    {
+        manager->release(reactor);
+    }
+    close(flushFd);
 }
 
 bool MulticastSender::sendMessage(const std::string &message)
+{
+    return sendMessage(message.data(), message.size());
+}
+
+bool MulticastSender::sendMessage(const char *data, size_t length)
+{
+    if (length > static_cast<size_t>(MAX_MESSAGE_SIZE))
+    {
+        if (callback)
+            callback(Event{INQUEUE_ERROR, "message too large"});
+        return false;
+    }
+
+    // 回调须在释放锁后调用，否则回调中再次发送会死锁，且回调耗时会阻塞发送线程
+    std::unique_lock<std::mutex> lock(queueMutex);
+
+    if (coalesceBytes > 0 && !reserved &&
+        length + COALESCE_RECORD_HEADER <= static_cast<size_t>(std::min(coalesceBytes, maxPayload)))
+    {
+        if (!coalesce(data, length))
+        {
+            lock.unlock();
+            if (callback)
+                callback(Event{INQUEUE_ERROR, "send window full"});
+            return false;
+        }
+        updateGauges();
+        notifyPending();
+        return true;
+    }
+
+    // 按负载大小切分，空消息也占一个报文
+    int fragCount = std::max<int>(1, static_cast<int>((length + maxPayload - 1) / maxPayload));
+    if (reserved || sendQueue.capacity() - sendQueue.size() < fragCount)
+    {
+        // 窗口已满，等待ACK释放空间
+        lock.unlock();
+        if (callback)
+            callback(Event{INQUEUE_ERROR, "send window full"});
+        return false;
+    }
+
+    // 直接在窗口槽位中构造报文，只拷贝一次负载
+    for (int i = 0; i < fragCount; ++i)
+    {
+        size_t offset = static_cast<size_t>(i) * maxPayload;
+        Message *slot = sendQueue.prepare();
+        fillSlot(slot, std::min<size_t>(maxPayload, length - offset), i, fragCount);
+        memcpy(slot->content, data + offset, slot->length);
+        sendQueue.commit();
+        TRACE_DEBUG(TRACE_ENQUEUE, sequenceNumber, slot->length);
+        sequenceNumber++;
+    }
+    // 其后的消息不能再并入之前的合并报文
+    coalesceOpen = false;
+    messageNumber++;
+    messagesEnqueued.add(fragCount);
+    updateGauges();
+    notifyPending();
+    return true;
+}
+
+bool MulticastSender::reserve(SendBuffer &buffer)
+{
+    std::unique_lock<std::mutex> lock(queueMutex);
+
+    Message *slot = reserved ? nullptr : sendQueue.prepare();
+    if (slot == nullptr)
+    {
+        lock.unlock();
+        if (callback)
+            callback(Event{INQUEUE_ERROR, "send window full"});
+        return false;
+    }
+
+    // 预留期间槽位位于窗口末尾之外，发送线程不会访问
+    reserved = true;
+    buffer.data = slot->content;
+    buffer.capacity = maxPayload;
+    buffer.sequenceNumber = sequenceNumber;
+    return true;
+}
+
+bool MulticastSender::commit(const SendBuffer &buffer, size_t length)
 {
     std::lock_guard<std::mutex> lock(queueMutex);
-    Message msg(DATA, sequenceNumber, message);
-    if (!sendQueue.push_back(msg))
+
+    if (!reserved || buffer.sequenceNumber != sequenceNumber || length > static_cast<size_t>(maxPayload))
     {
         return false;
     }
-    std::cout << "Enqueued: " << msg.sequenceNumber << ": " << msg.content << std::endl;
+
+    Message *slot = sendQueue.prepare();
+    fillSlot(slot, length, 0, 1);
+    sendQueue.commit();
+    TRACE_DEBUG(TRACE_ENQUEUE, sequenceNumber, slot->length);
     sequenceNumber++;
+    coalesceOpen = false;
+    messageNumber++;
+    reserved = false;
+    messagesEnqueued.add();
+    updateGauges();
+    notifyPending();
+    return true;
+}
+
+void MulticastSender::cancel(const SendBuffer &buffer)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (buffer.sequenceNumber == sequenceNumber)
+    {
+        reserved = false;
+    }
+}
+
+void MulticastSender::fillSlot(Message *slot, size_t length, int fragIndex, int fragCount)
+{
+    slot->type = DATA;
+    slot->flags = 0;
+    slot->length = static_cast<uint16_t>(length);
+    slot->sequenceNumber = toWireSeq(sequenceNumber);
+    slot->nodeId = 0;
+    slot->fragIndex = static_cast<uint16_t>(fragIndex);
+    slot->fragCount = static_cast<uint16_t>(fragCount);
+    if (coalesceBytes > 0)
+    {
+        // 同一会话中的报文统一使用消息序号，接收方交付序号保持连续
+        slot->flags = MESSAGE_NUMBERED;
+        slot->nodeId = static_cast<int32_t>(toWireSeq(messageNumber));
+    }
+}
+
+bool MulticastSender::coalesce(const char *data, size_t length)
+{
+    size_t limit = static_cast<size_t>(std::min(coalesceBytes, maxPayload));
+    size_t record = COALESCE_RECORD_HEADER + length;
+    Message *slot = coalesceOpen ? &sendQueue.at(sequenceNumber - 1) : nullptr;
+    if (slot == nullptr || slot->length + record > limit)
+    {
+        slot = sendQueue.prepare();
+        if (slot == nullptr)
+        {
+            return false;
+        }
+        fillSlot(slot, 0, 0, 1);
+        slot->flags = MESSAGE_NUMBERED | MESSAGE_BATCH;
+        sendQueue.commit();
+        TRACE_DEBUG(TRACE_ENQUEUE, sequenceNumber, 0);
+        sequenceNumber++;
+        coalesceOpen = true;
+        coalesceOpenedUs = TokenBucket::nowUs();
+    }
+    else
+    {
+        messagesCoalesced.add();
+    }
+
+    // 报文尚未发出，发送线程取报文前会持有同一把锁
+    uint16_t recordLength = static_cast<uint16_t>(length);
+    memcpy(slot->content + slot->length, &recordLength, sizeof(recordLength));
+    memcpy(slot->content + slot->length + sizeof(recordLength), data, length);
+    slot->length = static_cast<uint16_t>(slot->length + record);
+    messageNumber++;
+    messagesEnqueued.add();
+    if (slot->length + COALESCE_RECORD_HEADER >= static_cast<int>(limit))
+    {
+        // 已放不下任何消息，无需再等待
+        coalesceOpen = false;
+    }
     return true;
 }
 
 void MulticastSender::start()
 {
-    running = true;
-    senderThread = std::thread(&MulticastSender::run, this);
+    if (running.exchange(true))
+    {
+        return;
+    }
+    reactor->invoke([this]()
+                    { attach(); });
+    if (ownedReactor)
+    {
+        senderThread = std::thread(&MulticastSender::run, this);
+    }
 }
 
 void MulticastSender::stop()
 {
+    if (!running)
+    {
+        return;
+    }
+    // 先在事件循环中注销，之后不会再有回调访问本对象
+    reactor->invoke([this]()
+                    { detach(); });
     running = false;
-    if (senderThread.joinable())
+    if (ownedReactor)
     {
-        senderThread.join();
+        reactor->wakeup();
+        if (senderThread.joinable())
+        {
+            senderThread.join();
+        }
     }
 }
 
 void MulticastSender::run()
 {
-    fd_set readFds;
-    while (running)
+    reactor->run(running);
+}
+
+void MulticastSender::attach()
+{
+    reactor->addFd(transport->fd(), EPOLLIN, [this](uint32_t)
+                   { onReadable(); });
+    reactor->addFd(flushFd, EPOLLIN, [this](uint32_t)
+                   { onFlush(); });
+}
+
+void MulticastSender::detach()
+{
+    reactor->removeFd(transport->fd());
+    reactor->removeFd(flushFd);
+    if (ackTimer != 0)
     {
-        FD_ZERO(&readFds);
-        FD_SET(sockfd, &readFds);
+        reactor->cancelTimer(ackTimer);
+        ackTimer = 0;
+    }
+    if (flushTimer != 0)
+    {
+        reactor->cancelTimer(flushTimer);
+        flushTimer = 0;
+    }
+    if (fecTimer != 0)
+    {
+        reactor->cancelTimer(fecTimer);
+        fecTimer = 0;
+    }
+}
 
-        int ret = select(sockfd + 1, &readFds, nullptr, nullptr, nullptr);
-        if (ret > 0 && FD_ISSET(sockfd, &readFds))
+void MulticastSender::onReadable()
+{
+    // 读空套接字，源地址单独存放，避免覆盖组播目的地址
+    Message msg(INIT, 0, 0, "");
+    struct sockaddr_in from;
+    ssize_t n;
+    while ((n = transport->recvFrom(&msg, sizeof(msg), &from)) > 0)
+    {
+        if (!msg.isValid(n))
         {
-            Message msg(INIT, 0, 0, "");
-            socklen_t len = sizeof(addr);
-            int n = recvfrom(sockfd, &msg, sizeof(msg), 0, (struct sockaddr *)&addr, &len);
-            if (n > 0)
-            {
-                switch (msg.type)
-                {
-                case ACK:
-                    handleACK(msg);
-                    break;
-                case NACK:
-                    handleNACK(msg);
-                    break;
-                default:
-                    auto now = std::chrono::steady_clock::now();
-                    std::chrono::duration<double> elapsedSeconds = now - lastAckTime;
-                    if (sequenceNumber - lastAckExchange + 1 >= SEND_ACK_COUNT || elapsedSeconds.count() >= ackTimeout)
-                    {
-                        requestACK();
-                        lastAckTime = now;
-                    }
-
-                    sendPendingMessages();
-                    break;
-                }
-            }
+            continue;
         }
-        else
+
+        switch (msg.type)
         {
-            // 无事件，处理发包逻辑
-            auto now = std::chrono::steady_clock::now();
-            std::chrono::duration<double> elapsedSeconds = now - lastAckTime;
-            if (sequenceNumber - lastAckExchange + 1 >= SEND_ACK_COUNT || elapsedSeconds.count() >= ackTimeout)
+        case ACK:
+            handleACK(msg);
+            break;
+        case NACK:
+            handleNACK(msg);
+            break;
+        case INIT:
+            handleJoin(msg);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void MulticastSender::notifyPending()
+{
+    // 已有未处理的通知时不重复写eventfd
+    if (!flushPending.exchange(true))
+    {
+        uint64_t one = 1;
+        ssize_t n = write(flushFd, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+void MulticastSender::onFlush()
+{
+    uint64_t value;
+    ssize_t n = read(flushFd, &value, sizeof(value));
+    (void)n;
+    flushPending = false;
+
+    scheduleAfterSend(sendPendingMessages());
+}
+
+void MulticastSender::scheduleAfterSend(int delayMs)
+{
+    // 单轮发送达到包数上限时经eventfd立即续发，同一轮epoll中先处理已到达的ACK/NACK；
+    // 令牌不足或发送缓冲区已满时才定时续发
+    if (delayMs == 0)
+    {
+        notifyPending();
+    }
+    else if (delayMs > 0 && flushTimer == 0)
+    {
+        flushTimer = reactor->runAfter(delayMs, [this]()
+                                      {
+            flushTimer = 0;
+            scheduleAfterSend(sendPendingMessages()); });
+    }
+
+    // 发送空闲时不再等待分组填满，稍后发出未满分组的校验
+    if (delayMs < 0 && fecBlockFill > 0 && !fecReady && fecTimer == 0)
+    {
+        fecTimer = reactor->runAfter(FEC_FLUSH_DELAY, [this]()
+                                    {
+            fecTimer = 0;
             {
-                requestACK();
-                lastAckTime = now;
+                std::lock_guard<std::mutex> lock(queueMutex);
+                if (fecBlockFill > 0 && !fecReady && sendPointer >= sendQueue.end())
+                {
+                    closeParity();
+                }
             }
+            scheduleAfterSend(sendPendingMessages()); });
+    }
 
-            sendPendingMessages();
-        }
+    // 新发出的包累计到SEND_ACK_COUNT时立即请求ACK
+    if (sendPointer - lastAckRequest >= SEND_ACK_COUNT)
+    {
+        onAckTimer();
+    }
+    else if (ackTimer == 0 && sendPointer > lastAckExchange)
+    {
+        // 有未确认数据时才启动ACK定时器，空闲会话不产生定时事件
+        ackTimer = reactor->runAfter(static_cast<uint64_t>(ackTimeout * 1000), [this]()
+                                    {
+            ackTimer = 0;
+            onAckTimer(); });
+    }
+}
+
+void MulticastSender::onAckTimer()
+{
+    if (ackTimer != 0)
+    {
+        reactor->cancelTimer(ackTimer);
+        ackTimer = 0;
+    }
+
+    lastAckRequest = sendPointer;
+    requestACK();
+    // 日志换段用的新段在锁外预先创建，requestACK 持锁追加时只做内存拷贝
+    sendLog.prepare();
+
+    bool inFlight;
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        inFlight = !sendQueue.empty();
+    }
+    if (inFlight)
+    {
+        ackTimer = reactor->runAfter(static_cast<uint64_t>(ackTimeout * 1000), [this]()
+                                    {
+            ackTimer = 0;
+            onAckTimer(); });
     }
 }
 
@@ -132,143 +447,666 @@ void MulticastSender::setCallback(std::function<void(const Event &)> cb)
     callback = cb;
 }
 
+void MulticastSender::setBatchSize(int size)
+{
+    batchSize = std::max(1, std::min(size, MAX_SEND_BATCH));
+}
+
+void MulticastSender::setMaxPayload(int bytes)
+{
+    maxPayload = std::max(1, std::min(bytes, fecBlockSize > 0 ? MAX_FEC_PAYLOAD_SIZE : MAX_PAYLOAD_SIZE));
+}
+
+void MulticastSender::setFec(int blockSize)
+{
+    fecBlockSize = std::max(0, std::min(blockSize, MAX_FEC_BLOCK));
+    if (fecBlockSize > 0)
+    {
+        // 校验报文需额外携带 FecHeader
+        maxPayload = std::min(maxPayload, MAX_FEC_PAYLOAD_SIZE);
+    }
+}
+
+bool MulticastSender::setSendLog(const std::string &directory, size_t segmentBytes, int maxSegments, int rollMs)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return sendLog.open(directory, segmentBytes, maxSegments, rollMs);
+}
+
+void MulticastSender::setCoalescing(int maxBytes, int holdMs)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    coalesceBytes = std::max(0, std::min(maxBytes, MAX_PAYLOAD_SIZE));
+    coalesceHoldUs = static_cast<uint64_t>(std::max(0, holdMs)) * 1000;
+    coalesceOpen = false;
+}
+
+void MulticastSender::setInitialSequence(int64_t seq)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (!sendQueue.empty() || reserved)
+    {
+        return;
+    }
+    sendQueue.reset(seq);
+    sequenceNumber = seq;
+    sendPointer = seq;
+    lastAckExchange = seq;
+    lastAckRequest = seq;
+    messageNumber = seq;
+}
+
+void MulticastSender::setPacing(double bytesPerSec, double packetsPerSec, double burstBytes, double burstPackets)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    pacer.setRate(bytesPerSec, packetsPerSec, burstBytes, burstPackets);
+}
+
+void MulticastSender::setRateControl(const RateConfig &config)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    rateControl.configure(config);
+    rateControlled = true;
+    double rate = rateControl.rate();
+    pacer.adjustRate(rate, std::max(rate * RATE_BURST_MS / 1000, static_cast<double>(MAX_DATAGRAM_SIZE)),
+                     TokenBucket::nowUs());
+    updateGauges();
+}
+
+RateControlStats MulticastSender::getRateStats()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (!rateControlled)
+    {
+        RateControlStats stats = RateControlStats();
+        stats.limitingReceiver = -1;
+        return stats;
+    }
+    return rateControl.stats();
+}
+
+PacingStats MulticastSender::getPacingStats()
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    return pacer.stats(TokenBucket::nowUs());
+}
+
+BatchStats MulticastSender::getBatchStats() const
+{
+    BatchStats stats;
+    stats.batches = batchCount.load(std::memory_order_relaxed);
+    stats.syscalls = syscallCount.load(std::memory_order_relaxed);
+    stats.datagrams = datagramCount.load(std::memory_order_relaxed);
+    return stats;
+}
+
+SenderStats MulticastSender::getStats() const
+{
+    SenderStats stats;
+    stats.messagesEnqueued = messagesEnqueued.get();
+    stats.messagesCoalesced = messagesCoalesced.get();
+    stats.packetsSent = packetsSent.get();
+    stats.bytesSent = bytesSent.get();
+    stats.repairsSent = repairsSent.get();
+    stats.logRepairsSent = logRepairsSent.get();
+    stats.parityPacketsSent = parityPacketsSent.get();
+    stats.acksReceived = acksReceived.get();
+    stats.ackRequestsSent = ackRequestsSent.get();
+    stats.nacksReceived = nacksReceived.get();
+    stats.nackRangesRejected = nackRangesRejected.get();
+    stats.receiversEvicted = receiversEvicted.get();
+    stats.receivers = receiverGauge.get();
+    stats.windowOccupancy = occupancyGauge.get();
+    stats.windowCapacity = sendQueue.capacity();
+    stats.unsentPackets = unsentGauge.get();
+    stats.repairBacklog = repairBacklogGauge.get();
+    stats.logPackets = logGauge.get();
+    stats.sendRate = rateGauge.get();
+    stats.limitingReceiver = static_cast<int64_t>(limitingGauge.get());
+    stats.batch = getBatchStats();
+    stats.repairLatencyUs = repairLatency.snapshot();
+    stats.windowSize = windowSize.snapshot();
+    return stats;
+}
+
+void MulticastSender::addToBatch(const Message &msg)
+{
+    batchIovs[batchFill].iov_base = const_cast<Message *>(&msg);
+    batchIovs[batchFill].iov_len = msg.wireSize();
+    batchFill++;
+}
+
+// 发出当前批次，返回成功发送的报文数；发送缓冲区满时剩余报文被丢弃，由调用方决定是否重试
+int MulticastSender::flushBatch()
+{
+    if (batchFill == 0)
+        return 0;
+
+    int sent = 0;
+    while (sent < batchFill)
+    {
+        int n = transport->sendBatch(&batchHdrs[sent], batchFill - sent);
+        syscallCount.fetch_add(1, std::memory_order_relaxed);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        sent += n;
+    }
+
+    batchCount.fetch_add(1, std::memory_order_relaxed);
+    datagramCount.fetch_add(sent, std::memory_order_relaxed);
+    batchFill = 0;
+    return sent;
+}
+
 void MulticastSender::requestACK()
 {
     std::lock_guard<std::mutex> lock(queueMutex);
 
+    updateRate();
+    // 请求中带上发送时间，接收方在ACK中带回
+    uint64_t stamp = TokenBucket::nowUs();
+    Message msg(ACK_REQUEST, sendPointer - 1, 0, reinterpret_cast<const char *>(&stamp), sizeof(stamp));
+
     // 当table为空时怎么办，当table只有一部分节点时怎么办？
     if (receiverTable.empty())
     {
         // 发送新ACK请求
-        Message msg(ACK_REQUEST, 0, "");
-        sendto(sockfd, &msg, sizeof(msg), 0, (const struct sockaddr *)&addr, sizeof(addr));
-        std::cout << "Sent ACK Request" << std::endl;
+        transport->sendTo(&msg, msg.wireSize(), addr);
+        TRACE_INFO(TRACE_ACK_REQUEST, -1, 0);
+        ackRequestsSent.add();
         return;
     }
 
-    // 清理发送缓冲区
-    ReceiverNode minNode(std::numeric_limits<int>::max(), 0);
-    for (const auto &node : receiverTable)
-    {
-        if (node.ackSequenceNumber < minNode.ackSequenceNumber)
-            minNode = node;
-    }
+    // 清理发送缓冲区：ack已落在窗口之前的接收方由发送日志补包，不再限制窗口释放，只参与踢除检查
+    ReceiverNode minNode = *receiverTable.min();
+    const ReceiverNode *limitNode = receiverTable.minAtLeast(sendQueue.begin() - 1);
+    int64_t limit = limitNode != nullptr ? limitNode->ackSequenceNumber : sendPointer - 1;
 
     // 记录当前ACK
-    lastAckExchange = minNode.ackSequenceNumber;
+    lastAckExchange = limit;
 
-    // 遍历 sendQueue，移除所有 sequenceNumber 小于 minNode 的消息
-    auto it = sendQueue.begin();
-    if (it != sendQueue.end() && it->sequenceNumber <= minNode.ackSequenceNumber)
+    // 释放所有 sequenceNumber 不大于 limit 的消息，只移动窗口头部
+    if (!sendQueue.empty() && sendQueue.begin() <= limit)
     {
-        while (it != sendQueue.end())
+        int64_t releaseSeq = std::min(limit, sendPointer - 1);
+        if (sendLog.isOpen())
         {
-            if (it->sequenceNumber <= minNode.ackSequenceNumber)
-                it = sendQueue.erase(it);
-            else
-                ++it;
+            // 释放前转存到发送日志，落后的接收方仍可补包
+            uint64_t nowMs = Reactor::nowMs();
+            for (int64_t seq = sendQueue.begin(); seq <= releaseSeq; ++seq)
+            {
+                sendLog.append(seq, sendQueue.at(seq), nowMs);
+            }
         }
+        sendQueue.releaseUpTo(releaseSeq);
     }
-    else
+
+    if (stalled(minNode))
     {
-        // 踢除ACK发送过慢的节点，当都很慢时怎么办？
-        if (sendPointer->sequenceNumber > minNode.ackSequenceNumber + DELETE_COUNT)
-            receiverTable.erase(minNode);
+        // 启用速率控制时先降速，速率已为该节点降到下限仍跟不上才踢除
+        if (!(rateControlled && rateControl.slowingFor(minNode.nodeId)))
+        {
+            TRACE_WARN(TRACE_RECEIVER_EVICTED, minNode.nodeId, minNode.ackSequenceNumber);
+            receiverTable.erase(minNode.nodeId);
+            rateControl.erase(minNode.nodeId);
+            receiversEvicted.add();
+        }
     }
 
-    // 发送新ACK请求
-    Message msg(ACK_REQUEST, 0, "");
-    sendto(sockfd, &msg, sizeof(msg), 0, (const struct sockaddr *)&addr, sizeof(addr));
-    std::cout << "Sent ACK Request" << std::endl;
+    // 发送新ACK请求，携带已发出的最大序号，接收方据此发现尾部丢失
+    transport->sendTo(&msg, msg.wireSize(), addr);
+    TRACE_INFO(TRACE_ACK_REQUEST, lastAckExchange, receiverTable.size());
+    ackRequestsSent.add();
+    updateGauges();
 }
 
 void MulticastSender::handleACK(const Message &msg)
 {
     std::lock_guard<std::mutex> lock(queueMutex);
-    std::cout << "Received ACK: " << msg.sequenceNumber << std::endl;
+    // 接收方确认的序号不会超过已发出的位置，以发送位置为参照还原
+    int64_t ack = fromWireSeq(msg.sequenceNumber, sendPointer);
+    TRACE_INFO(TRACE_ACK_RECEIVED, msg.nodeId, ack);
+
+    // 新接收方加入表中，已有接收方保留较大的ack
+    receiverTable.update(msg.nodeId, ack, Reactor::nowMs());
+    if (rateControlled)
+    {
+        // 带回的时间戳来自本端的ACK请求
+        uint64_t rttUs = 0;
+        uint64_t stamp;
+        if (msg.length == sizeof(stamp))
+        {
+            memcpy(&stamp, msg.content, sizeof(stamp));
+            uint64_t now = TokenBucket::nowUs();
+            rttUs = now > stamp ? now - stamp : 0;
+        }
+        rateControl.onAck(msg.nodeId, ack, rttUs);
+    }
+    acksReceived.add();
+    receiverGauge.set(receiverTable.size());
+}
+
+void MulticastSender::handleJoin(const Message &msg)
+{
+    std::lock_guard<std::mutex> lock(queueMutex);
+    JoinInfo info = {retainedBegin(), sendPointer - 1, messageNumber};
+    TRACE_INFO(TRACE_JOIN_REQUEST, msg.nodeId, info.oldest);
+
+    // 先按最早可补发的位置登记：该位置在窗口内时，首个ACK到达前窗口不会越过新接收方可能请求的历史；
+    // 在发送日志中时由日志补包，不阻塞窗口释放
+    receiverTable.update(msg.nodeId, info.oldest - 1, Reactor::nowMs());
+    receiverGauge.set(receiverTable.size());
+
+    // 同一主机上的接收方共用端口，单播应答只会到达其中一个，因此组播应答，接收方按 nodeId 取给自己的应答
+    Message reply(INIT, info.highest, msg.nodeId, reinterpret_cast<const char *>(&info), sizeof(info));
+    transport->sendTo(&reply, reply.wireSize(), addr);
+}
 
-    // 按id检查接收方是否在表中
-    auto it = receiverTable.find(ReceiverNode(0, msg.nodeId));
+void MulticastSender::handleNACK(const Message &msg)
+{
+    NackHeader header;
+    if (!parseNack(msg, header))
+    {
+        return;
+    }
+
+    // 本NACK中被接受的区间合并为一个NCF组播
+    Message ncf(INIT, 0, 0, "");
+    initNack(ncf, NCF, header.base, 0);
 
-    if (it != receiverTable.end())
+    // 无法补发的区间在释放锁后逐个回调
+    int rejected = 0;
     {
-        // 接收方已存在，更新较大的ack
-        if (it->ackSequenceNumber < msg.sequenceNumber)
+        std::lock_guard<std::mutex> lock(queueMutex);
+        uint64_t now = TokenBucket::nowUs();
+        nacksReceived.add();
+        // 仍在发NACK的接收方正在恢复，不会因ack停滞被踢除
+        receiverTable.touch(msg.nodeId, now / 1000);
+
+        for (int i = 0; i < header.rangeCount; ++i)
+        {
+            NackRange wire = nackRange(msg, i);
+            int64_t start = fromWireSeq(wire.start, sendPointer);
+            int64_t end = fromWireSeq(wire.end, sendPointer);
+            TRACE_INFO(TRACE_NACK_RECEIVED, start, end);
+            if (rateControlled && start <= end && end < sendPointer)
+            {
+                // 已无法补发的区间同样说明该接收方在丢包
+                rateControl.onNack(msg.nodeId, start, end);
+            }
+            if (start > end || start < retainedBegin() || end >= sendPointer)
+            {
+                // 回调无法处理的事件
+                TRACE_WARN(TRACE_NACK_OUT_WINDOW, start, end);
+                nackRangesRejected.add();
+                rejected++;
+                continue;
+            }
+
+            // 保持期内已排队或已补发的序号不再重复补发，其余的连续区间合并进重传队列，
+            // 并通过NCF让仍在退避的接收方抑制相同的NACK
+            int64_t runStart = -1;
+            for (int64_t seq = start; seq <= end + 1; ++seq)
+            {
+                std::pair<int64_t, uint64_t> *stamp =
+                    seq <= end ? &repairStamps[seq & (repairStamps.size() - 1)] : nullptr;
+                if (stamp && (stamp->first != seq || now - stamp->second >= static_cast<uint64_t>(REPAIR_HOLDDOWN) * 1000))
+                {
+                    *stamp = std::make_pair(seq, now);
+                    if (runStart < 0)
+                    {
+                        runStart = seq;
+                    }
+                }
+                else if (runStart >= 0)
+                {
+                    queueRepair(runStart, seq - 1);
+                    appendNackRange(ncf, runStart, seq - 1);
+                    runStart = -1;
+                }
+            }
+        }
+
+        if (ncf.length > NACK_HEADER_SIZE)
         {
-            ReceiverNode updatedNode = *it;
-            updatedNode.ackSequenceNumber = msg.sequenceNumber;
-            receiverTable.erase(it);
-            receiverTable.insert(updatedNode);
+            transport->sendTo(&ncf, ncf.wireSize(), addr);
         }
+        updateGauges();
     }
-    else
+
+    for (int i = 0; i < rejected && callback; ++i)
     {
-        // 接收方不存在，添加新节点
-        ReceiverNode newReceiver(msg.sequenceNumber, msg.nodeId);
-        receiverTable.insert(newReceiver);
+        callback(Event{NACK_OUT_QUEUE, "NACK range out of send window"});
     }
+    scheduleAfterSend(sendPendingMessages());
 }
 
-void MulticastSender::handleNACK(const Message &msg)
+void MulticastSender::updateGauges()
 {
-    std::string nackContent(msg.content);
-    size_t pos = nackContent.find(" ");
-    int startSeq = std::stoi(nackContent.substr(0, pos));
-    int endSeq = std::stoi(nackContent.substr(pos + 1));
-    std::cout << "Received NACK for range: " << startSeq << " - " << endSeq << std::endl;
+    uint64_t backlog = 0;
+    for (const std::pair<int64_t, int64_t> &range : repairQueue)
+    {
+        backlog += range.second - range.first + 1;
+    }
+    occupancyGauge.set(sendQueue.size());
+    unsentGauge.set(sendQueue.end() - sendPointer);
+    repairBacklogGauge.set(backlog);
+    logGauge.set(sendLog.end() - sendLog.begin());
+    receiverGauge.set(receiverTable.size());
+    if (rateControlled)
+    {
+        RateControlStats rate = rateControl.stats();
+        rateGauge.set(static_cast<uint64_t>(rate.rate));
+        limitingGauge.set(static_cast<uint64_t>(static_cast<int64_t>(rate.limitingReceiver)));
+    }
+}
 
-    if (startSeq < sendQueue.front().sequenceNumber || endSeq > sequenceNumber)
+void MulticastSender::updateRate()
+{
+    if (!rateControlled)
     {
-        // 回调无法处理的事件
         return;
     }
+    uint64_t now = TokenBucket::nowUs();
+    // 积压超过窗口的1/8时开始按接收方的消费速率限速
+    int backlogLimit = sendQueue.capacity() / 8;
+    double rate = rateControl.update(now, sendPointer, bytesSent.get(), packetsSent.get(), backlogLimit);
+    pacer.adjustRate(rate, std::max(rate * RATE_BURST_MS / 1000, static_cast<double>(MAX_DATAGRAM_SIZE)), now);
+}
 
-    std::lock_guard<std::mutex> lock(queueMutex);
+bool MulticastSender::stalled(const ReceiverNode &node) const
+{
+    int64_t missing = node.ackSequenceNumber + 1;
+    if (missing >= sendPointer)
+    {
+        return false;
+    }
+    if (missing < retainedBegin())
+    {
+        // 缺失的报文已无法补发，继续等待只会阻塞窗口
+        return true;
+    }
+    uint64_t nowMs = Reactor::nowMs();
+    if (nowMs - node.activeMs < static_cast<uint64_t>(EVICT_TIMEOUT_MS))
+    {
+        return false;
+    }
+    // 被NCF抑制的接收方不发NACK，其缺失的报文近期仍在补发时同样视为在恢复
+    const std::pair<int64_t, uint64_t> &stamp = repairStamps[missing & (repairStamps.size() - 1)];
+    return stamp.first != missing || nowMs - stamp.second / 1000 >= static_cast<uint64_t>(EVICT_TIMEOUT_MS);
+}
+
+int64_t MulticastSender::retainedBegin() const
+{
+    // 日志与窗口衔接时可从日志头部开始补发
+    if (sendLog.isOpen() && sendLog.end() == sendQueue.begin() && sendLog.begin() < sendLog.end())
+    {
+        return sendLog.begin();
+    }
+    return sendQueue.begin();
+}
 
-    // 二分查找NACK的起始节点
-    auto it = std::lower_bound(sendQueue.begin(), sendQueue.end(), startSeq,
-                               [](const Message &msg, int seq)
-                               { return msg.sequenceNumber < seq; });
+const Message *MulticastSender::retained(int64_t seq) const
+{
+    if (seq >= sendQueue.begin())
+    {
+        return &sendQueue.at(seq);
+    }
+    return sendLog.find(seq);
+}
 
-    // 从找到的起始点开始顺序遍历补包
-    for (; it != sendQueue.end() && it->sequenceNumber <= endSeq; ++it)
+void MulticastSender::queueRepair(int64_t startSeq, int64_t endSeq)
+{
+    // 找到第一个可能与新区间重叠或相邻的区间，向后吞并所有重叠区间
+    auto it = repairQueue.begin();
+    while (it != repairQueue.end() && it->second + 1 < startSeq)
+    {
+        ++it;
+    }
+    while (it != repairQueue.end() && it->first <= endSeq + 1)
     {
-        // 这里it.sequenceNumber已经保证是[startSeq, endSeq]之间的值
-        it->type = REPAIR;
-        sendto(sockfd, &(*it), sizeof(*it), 0, (const struct sockaddr *)&addr, sizeof(addr));
-        std::cout << "Retransmitted: " << it->sequenceNumber << ": " << it->content << std::endl;
+        startSeq = std::min(startSeq, it->first);
+        endSeq = std::max(endSeq, it->second);
+        it = repairQueue.erase(it);
+    }
+    repairQueue.insert(it, std::make_pair(startSeq, endSeq));
+}
+
+bool MulticastSender::sendRepairs(uint64_t now, int &sendCount)
+{
+    while (!repairQueue.empty())
+    {
+        std::pair<int64_t, int64_t> &range = repairQueue.front();
+        // 已被确认释放的部分无需补发
+        range.first = std::max(range.first, retainedBegin());
+        if (range.first > range.second)
+        {
+            repairQueue.pop_front();
+            continue;
+        }
+        if (sendCount >= SEND_COUNT)
+        {
+            return false;
+        }
+
+        // 按序号直接定位补包起点，顺序补包并按批次合并发送
+        int64_t seq = range.first;
+        while (seq <= range.second && batchFill < batchSize && sendCount + batchFill < SEND_COUNT)
+        {
+            if (seq >= sendQueue.begin())
+            {
+                sendQueue.at(seq).type = REPAIR;
+            }
+            const Message *repair = retained(seq);
+            if (!pacer.tryConsume(repair->wireSize(), now))
+            {
+                break;
+            }
+            addToBatch(*repair);
+            ++seq;
+        }
+
+        int pending = batchFill;
+        if (pending == 0)
+        {
+            // 令牌不足
+            return false;
+        }
+        int sent = flushBatch();
+        for (int i = 0; i < sent; ++i)
+        {
+            int64_t seq = range.first + i;
+            TRACE_DEBUG(TRACE_RETRANSMIT, seq, retained(seq)->length);
+            if (seq < sendQueue.begin())
+            {
+                logRepairsSent.add();
+            }
+            const std::pair<int64_t, uint64_t> &stamp = repairStamps[seq & (repairStamps.size() - 1)];
+            if (stamp.first == seq && now >= stamp.second)
+            {
+                repairLatency.record(now - stamp.second);
+            }
+        }
+        repairsSent.add(sent);
+        range.first += sent;
+        sendCount += sent;
+        if (sent < pending)
+        {
+            // 发送缓冲区已满，剩余部分留待下一轮
+            sendBlocked = true;
+            return false;
+        }
     }
+    return true;
 }
 
-void MulticastSender::sendPendingMessages()
+int MulticastSender::sendPendingMessages()
 {
     std::lock_guard<std::mutex> lock(queueMutex);
+    uint64_t now = TokenBucket::nowUs();
     int sendCount = 0;
+    sendBlocked = false;
+
+    // 未满的合并报文在等待期内不发出，到期后不再追加
+    int64_t sendEnd = sendQueue.end();
+    uint64_t holdUs = 0;
+    if (coalesceOpen)
+    {
+        uint64_t age = now - std::min(now, coalesceOpenedUs);
+        if (age < coalesceHoldUs)
+        {
+            sendEnd--;
+            holdUs = coalesceHoldUs - age;
+        }
+        else
+        {
+            coalesceOpen = false;
+        }
+    }
 
-    // 每次发送50个包
-    while (sendPointer != sendQueue.end() && sendCount < SEND_COUNT)
+    // 补包优先于新数据，上一分组的校验须先发出
+    if (sendRepairs(now, sendCount) && sendParity(now))
     {
-        sendto(sockfd, &*sendPointer, sizeof(*sendPointer), 0, (const struct sockaddr *)&addr, sizeof(addr));
-        std::cout << "Sent: " << sendPointer->sequenceNumber << ": " << sendPointer->content << std::endl;
-        sendPointer++;
-        sendCount++;
+        // 每次最多发送50个包，按批次调用sendmmsg
+        while (sendPointer < sendEnd && sendCount < SEND_COUNT)
+        {
+            int64_t seq = sendPointer;
+            // 启用FEC时一个批次不跨越分组边界
+            int64_t limit = fecBlockSize > 0 ? sendPointer + fecBlockSize - fecBlockFill : sendEnd;
+            while (seq < sendEnd && seq < limit && sendCount + batchFill < SEND_COUNT &&
+                   batchFill < batchSize && pacer.tryConsume(sendQueue.at(seq).wireSize(), now))
+            {
+                addToBatch(sendQueue.at(seq));
+                ++seq;
+            }
+
+            int pending = batchFill;
+            if (pending == 0)
+            {
+                // 令牌不足
+                break;
+            }
+            int sent = flushBatch();
+            for (int i = 0; i < sent; ++i)
+            {
+                const Message &msg = sendQueue.at(sendPointer);
+                TRACE_DEBUG(TRACE_SEND, sendPointer, msg.length);
+                bytesSent.add(msg.wireSize());
+                if (fecBlockSize > 0)
+                {
+                    foldParity(sendPointer, msg);
+                }
+                sendPointer++;
+            }
+            sendCount += sent;
+            packetsSent.add(sent);
+            if (sent < pending)
+            {
+                sendBlocked = true;
+            }
+            if (sendBlocked || !sendParity(now))
+            {
+                // 发送缓冲区已满或令牌不足，未发出的包留待下一轮
+                break;
+            }
+        }
+    }
+
+    windowSize.record(sendQueue.size());
+    updateGauges();
+
+    if (repairQueue.empty() && sendPointer >= sendEnd && !fecReady)
+    {
+        // 只剩等待中的合并报文时，到期后再发送
+        return holdUs > 0 ? static_cast<int>(std::max<uint64_t>(1, (holdUs + 999) / 1000)) : -1;
+    }
+
+    if (sendBlocked)
+    {
+        // 发送缓冲区已满，等待一个tick后重试
+        return 1;
+    }
+
+    // 按下一个待发报文计算令牌等待时间，令牌充足（只是本轮达到包数上限）时返回0
+    size_t nextSize;
+    if (!repairQueue.empty())
+    {
+        const Message *repair = retained(std::max(repairQueue.front().first, retainedBegin()));
+        nextSize = repair ? repair->wireSize() : static_cast<size_t>(MAX_DATAGRAM_SIZE);
+    }
+    else if (fecReady)
+    {
+        nextSize = fecParity.wireSize();
+    }
+    else
+    {
+        nextSize = sendQueue.at(sendPointer).wireSize();
     }
+    uint64_t waitUs = pacer.waitTime(nextSize, now);
+    return static_cast<int>((waitUs + 999) / 1000);
 }
 
-int main()
+void MulticastSender::foldParity(int64_t seq, const Message &msg)
 {
-    MulticastSender sender("239.255.0.1", 30001);
+    if (fecBlockFill == 0)
+    {
+        fecBlockStart = seq;
+        fecMaxLength = 0;
+        memset(&fecAccum, 0, sizeof(fecAccum));
+        memset(fecParity.content, 0, sizeof(fecParity.content));
+    }
 
-    sender.start();
+    // 负载按分组内最长报文补零后异或，报文头中接收方无法推知的字段单独异或
+    fecAccum.lengthXor ^= msg.length;
+    fecAccum.fragIndexXor ^= msg.fragIndex;
+    fecAccum.fragCountXor ^= msg.fragCount;
+    fecAccum.flagsXor ^= msg.flags;
+    fecAccum.nodeIdXor ^= msg.nodeId;
+    xorBytes(fecParity.content + FEC_HEADER_SIZE, msg.content, msg.length);
+    fecMaxLength = std::max<int>(fecMaxLength, msg.length);
 
-    for (int i = 0; i < 100; ++i)
+    if (++fecBlockFill == fecBlockSize)
     {
-        sender.sendMessage("Message " + std::to_string(i));
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        closeParity();
     }
+}
 
-    std::this_thread::sleep_for(std::chrono::seconds(10));
-    sender.stop();
+void MulticastSender::closeParity()
+{
+    fecParity.type = FEC;
+    fecParity.flags = 0;
+    fecParity.sequenceNumber = toWireSeq(fecBlockStart);
+    fecParity.nodeId = 0;
+    fecParity.fragIndex = 0;
+    fecParity.fragCount = static_cast<uint16_t>(fecBlockFill);
+    fecParity.length = static_cast<uint16_t>(FEC_HEADER_SIZE + fecMaxLength);
+    memcpy(fecParity.content, &fecAccum, FEC_HEADER_SIZE);
+    fecReady = true;
+}
 
-    return 0;
-}
\ No newline at end of file
+bool MulticastSender::sendParity(uint64_t now)
+{
+    if (!fecReady)
+    {
+        return true;
+    }
+    if (!pacer.tryConsume(fecParity.wireSize(), now))
+    {
+        return false;
+    }
+    if (transport->sendTo(&fecParity, fecParity.wireSize(), addr) < 0)
+    {
+        // 发送缓冲区已满，下一轮重试
+        sendBlocked = true;
+        return false;
+    }
+    TRACE_DEBUG(TRACE_FEC_SEND, fecBlockStart, fecParity.fragCount);
+    fecReady = false;
+    fecBlockFill = 0;
+    parityPacketsSent.add();
+    return true;
+}
@@ -0,0 +1,54 @@
+// 追踪文件离线解码：按时间戳排序后逐行输出
+// 用法：traceDecode <trace文件>
+#include "Trace.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "usage: %s <trace file>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (file == nullptr)
+    {
+        perror("open failed");
+        return 1;
+    }
+
+    TraceFileHeader header;
+    if (fread(&header, sizeof(header), 1, file) != 1 || memcmp(header.magic, "MCTRACE", 7) != 0 ||
+        header.recordSize != sizeof(TraceRecord))
+    {
+        fprintf(stderr, "%s: not a trace file or unsupported version\n", argv[1]);
+        fclose(file);
+        return 1;
+    }
+
+    std::vector<TraceRecord> records;
+    TraceRecord rec;
+    while (fread(&rec, sizeof(rec), 1, file) == 1)
+    {
+        records.push_back(rec);
+    }
+    fclose(file);
+
+    // 各线程缓冲分批落盘，按时间戳恢复全局顺序，同一线程内保持原顺序
+    std::stable_sort(records.begin(), records.end(), [](const TraceRecord &a, const TraceRecord &b)
+                     { return a.timestamp < b.timestamp; });
+
+    uint64_t start = records.empty() ? 0 : records.front().timestamp;
+    for (const TraceRecord &r : records)
+    {
+        uint64_t offset = r.timestamp - start;
+        printf("%llu.%06llu T%-3u %-5s %-16s %lld %lld\n", static_cast<unsigned long long>(offset / 1000000000),
+               static_cast<unsigned long long>(offset % 1000000000 / 1000), r.thread, Trace::levelName(r.level),
+               Trace::eventName(r.event), static_cast<long long>(r.arg0), static_cast<long long>(r.arg1));
+    }
+    return 0;
+}